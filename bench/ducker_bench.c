@@ -0,0 +1,230 @@
+/*
+ * Ducker offline benchmark
+ *
+ * Loads ducker.so through move_audio_fx_init_v2 with a stub host and times
+ * process_block per 128-frame block across every envelope phase, curve and
+ * mode. Reports mean ns/block, percentiles and CPU% of the block budget.
+ *
+ * Usage: ducker_bench [path/to/ducker.so] [-b blocks] [-i instances]
+ */
+
+#define _POSIX_C_SOURCE 199309L
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <time.h>
+#include <dlfcn.h>
+#include "audio_fx_api_v2.h"
+
+#define BENCH_FRAMES MOVE_FRAMES_PER_BLOCK
+#define BENCH_WARMUP_BLOCKS 64
+
+typedef void (*on_midi_fn)(void *instance, const uint8_t *msg, int len, int source);
+
+/* A scenario pins the envelope in one phase for most of its blocks. */
+typedef struct bench_scenario {
+    const char *name;
+    const char *attack;
+    const char *hold;
+    const char *release;
+    int period;        /* blocks between note-ons */
+    int off_after;     /* blocks after note-on to send note-off, -1 = never */
+    int send_notes;    /* 0 = idle, no MIDI at all */
+} bench_scenario_t;
+
+static const bench_scenario_t g_scenarios[] = {
+    /* name      attack  hold    release period off_after notes */
+    { "idle",    "0.10", "0.20", "0.30",    0,   -1, 0 },
+    { "attack",  "1.00", "1.00", "1.00",   16,   -1, 1 },  /* 50ms attack, retrig every 16 blocks */
+    { "hold",    "0.00", "1.00", "1.00",  160,   -1, 1 },  /* 500ms hold */
+    { "release", "0.00", "0.00", "1.00",  320,    0, 1 },  /* 1000ms release */
+    { "pump",    "0.10", "0.20", "0.30",  172,    8, 1 },  /* quarter notes at 120 BPM */
+};
+
+static const char *g_curves[] = { "Linear", "Expo", "S-Curve", "Pump" };
+static const char *g_modes[] = { "Trigger", "Gate" };
+
+static void stub_log(const char *msg) {
+    (void)msg;
+}
+
+static int stub_midi_send(const uint8_t *msg, int len) {
+    (void)msg;
+    return len;
+}
+
+static int stub_clock_status(void) {
+    return MOVE_CLOCK_STATUS_STOPPED;
+}
+
+static float stub_get_bpm(void) {
+    return 120.0f;
+}
+
+static inline uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static int cmp_u64(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t *)a;
+    uint64_t y = *(const uint64_t *)b;
+    return (x > y) - (x < y);
+}
+
+static void send_note(on_midi_fn on_midi, void **insts, int count, int on) {
+    uint8_t msg[3] = { (uint8_t)(on ? 0x90 : 0x80), 36, (uint8_t)(on ? 100 : 0) };
+    for (int k = 0; k < count; k++) {
+        on_midi(insts[k], msg, 3, MOVE_MIDI_SOURCE_INTERNAL);
+    }
+}
+
+static void run_scenario(audio_fx_api_v2_t *api, on_midi_fn on_midi,
+                         const bench_scenario_t *sc, const char *curve, const char *mode,
+                         int blocks, int instances, uint64_t *samples,
+                         const int16_t *source, int16_t *work) {
+    void **insts = calloc((size_t)instances, sizeof(void *));
+    for (int k = 0; k < instances; k++) {
+        insts[k] = api->create_instance(".", NULL);
+        api->set_param(insts[k], "channel", "Omni");
+        api->set_param(insts[k], "trigger_note", "36");
+        api->set_param(insts[k], "mode", mode);
+        api->set_param(insts[k], "curve", curve);
+        api->set_param(insts[k], "depth", "0.8");
+        api->set_param(insts[k], "attack", sc->attack);
+        api->set_param(insts[k], "hold", sc->hold);
+        api->set_param(insts[k], "release", sc->release);
+    }
+
+    size_t block_bytes = (size_t)BENCH_FRAMES * 2 * sizeof(int16_t);
+    int total = blocks + BENCH_WARMUP_BLOCKS;
+
+    for (int b = 0; b < total; b++) {
+        if (sc->send_notes && on_midi) {
+            int pos = b % sc->period;
+            if (pos == 0) send_note(on_midi, insts, instances, 1);
+            if (sc->off_after >= 0 && pos == sc->off_after) send_note(on_midi, insts, instances, 0);
+        }
+
+        /* Refill outside the timed region so gain is applied to fresh audio */
+        for (int k = 0; k < instances; k++) {
+            memcpy(work + (size_t)k * BENCH_FRAMES * 2, source, block_bytes);
+        }
+
+        uint64_t t0 = now_ns();
+        for (int k = 0; k < instances; k++) {
+            api->process_block(insts[k], work + (size_t)k * BENCH_FRAMES * 2, BENCH_FRAMES);
+        }
+        uint64_t t1 = now_ns();
+
+        if (b >= BENCH_WARMUP_BLOCKS) samples[b - BENCH_WARMUP_BLOCKS] = t1 - t0;
+    }
+
+    for (int k = 0; k < instances; k++) {
+        api->destroy_instance(insts[k]);
+    }
+    free(insts);
+}
+
+static void report(const char *phase, const char *curve, const char *mode,
+                   uint64_t *samples, int blocks, int instances) {
+    double sum = 0.0;
+    for (int i = 0; i < blocks; i++) sum += (double)samples[i];
+    qsort(samples, (size_t)blocks, sizeof(uint64_t), cmp_u64);
+
+    double mean = sum / blocks / instances;
+    double p50 = (double)samples[blocks / 2] / instances;
+    double p99 = (double)samples[(int)(blocks * 0.99)] / instances;
+    double max = (double)samples[blocks - 1] / instances;
+    double budget_ns = 1e9 * BENCH_FRAMES / MOVE_SAMPLE_RATE;
+
+    printf("%-8s %-8s %-8s %10.1f %10.1f %10.1f %10.1f %8.3f%%\n",
+           phase, curve, mode, mean, p50, p99, max, 100.0 * mean / budget_ns);
+}
+
+int main(int argc, char **argv) {
+    const char *so_path = "build/bench/ducker.so";
+    int blocks = 20000;
+    int instances = 1;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-b") == 0 && i + 1 < argc) {
+            blocks = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-i") == 0 && i + 1 < argc) {
+            instances = atoi(argv[++i]);
+        } else {
+            so_path = argv[i];
+        }
+    }
+    if (blocks < 100) blocks = 100;
+    if (instances < 1) instances = 1;
+
+    void *handle = dlopen(so_path, RTLD_NOW | RTLD_LOCAL);
+    if (!handle) {
+        fprintf(stderr, "dlopen failed: %s\n", dlerror());
+        return 1;
+    }
+
+    audio_fx_init_v2_fn init = (audio_fx_init_v2_fn)dlsym(handle, AUDIO_FX_INIT_V2_SYMBOL);
+    on_midi_fn on_midi = (on_midi_fn)dlsym(handle, "move_audio_fx_on_midi");
+    if (!init) {
+        fprintf(stderr, "missing %s in %s\n", AUDIO_FX_INIT_V2_SYMBOL, so_path);
+        return 1;
+    }
+
+    host_api_v1_t host;
+    memset(&host, 0, sizeof(host));
+    host.api_version = MOVE_PLUGIN_API_VERSION;
+    host.sample_rate = MOVE_SAMPLE_RATE;
+    host.frames_per_block = BENCH_FRAMES;
+    host.audio_out_offset = MOVE_AUDIO_OUT_OFFSET;
+    host.audio_in_offset = MOVE_AUDIO_IN_OFFSET;
+    host.log = stub_log;
+    host.midi_send_internal = stub_midi_send;
+    host.midi_send_external = stub_midi_send;
+    host.get_clock_status = stub_clock_status;
+    host.get_bpm = stub_get_bpm;
+
+    audio_fx_api_v2_t *api = init(&host);
+    if (!api) {
+        fprintf(stderr, "init returned NULL\n");
+        return 1;
+    }
+
+    /* Deterministic full-scale noise */
+    int16_t source[BENCH_FRAMES * 2];
+    uint32_t seed = 0x1234567u;
+    for (int i = 0; i < BENCH_FRAMES * 2; i++) {
+        seed = seed * 1664525u + 1013904223u;
+        source[i] = (int16_t)(seed >> 16);
+    }
+
+    int16_t *work = malloc((size_t)instances * BENCH_FRAMES * 2 * sizeof(int16_t));
+    uint64_t *samples = malloc((size_t)blocks * sizeof(uint64_t));
+
+    printf("ducker bench: %s, %d blocks x %d frames, %d instance(s)\n",
+           so_path, blocks, BENCH_FRAMES, instances);
+    printf("budget: %.1f ns/block; times are ns/block per instance\n\n",
+           1e9 * BENCH_FRAMES / MOVE_SAMPLE_RATE);
+    printf("%-8s %-8s %-8s %10s %10s %10s %10s %9s\n",
+           "phase", "curve", "mode", "mean", "p50", "p99", "max", "cpu");
+
+    int n_scenarios = (int)(sizeof(g_scenarios) / sizeof(g_scenarios[0]));
+    for (int s = 0; s < n_scenarios; s++) {
+        for (int c = 0; c < 4; c++) {
+            for (int m = 0; m < 2; m++) {
+                run_scenario(api, on_midi, &g_scenarios[s], g_curves[c], g_modes[m],
+                             blocks, instances, samples, source, work);
+                report(g_scenarios[s].name, g_curves[c], g_modes[m], samples, blocks, instances);
+            }
+        }
+    }
+
+    free(samples);
+    free(work);
+    dlclose(handle);
+    return 0;
+}
@@ -0,0 +1,38 @@
+#!/usr/bin/env bash
+# Build and run the Ducker offline benchmark natively
+#
+# Compiles ducker.so and the bench harness with the host compiler and runs it.
+# Extra arguments are passed through to the harness (e.g. -b 50000 -i 8).
+# Set CC to use a different compiler (e.g. CC=aarch64-linux-gnu-gcc to build
+# for the Move and copy build/bench/ over manually).
+# Set DUCKER_PERF=1 to also compile in the plugin's own hot-path timing.
+set -e
+
+SCRIPT_DIR="$(cd "$(dirname "$0")" && pwd)"
+REPO_ROOT="$(dirname "$SCRIPT_DIR")"
+CC="${CC:-gcc}"
+
+cd "$REPO_ROOT"
+
+echo "=== Building Ducker Bench ==="
+echo "Compiler: $CC"
+
+mkdir -p build/bench
+
+# Same optimisation level as scripts/build.sh, minus the CM4 tuning flags
+${CC} -Ofast -shared -fPIC \
+    -fomit-frame-pointer -fno-stack-protector \
+    -DNDEBUG ${DUCKER_PERF:+-DDUCKER_PERF} \
+    src/dsp/ducker.c \
+    -o build/bench/ducker.so \
+    -Isrc/dsp \
+    -lm
+
+${CC} -O2 \
+    bench/ducker_bench.c \
+    -o build/bench/ducker_bench \
+    -Isrc/dsp \
+    -ldl
+
+echo ""
+./build/bench/ducker_bench build/bench/ducker.so "$@"
@@ -3,6 +3,7 @@
 #
 # Automatically uses Docker for cross-compilation if needed.
 # Set CROSS_PREFIX to skip Docker (e.g., for native ARM builds).
+# Set DUCKER_PERF=1 to build with hot-path timing (get_param "perf_stats").
 set -e
 
 SCRIPT_DIR="$(cd "$(dirname "$0")" && pwd)"
@@ -26,6 +27,7 @@ if [ -z "$CROSS_PREFIX" ] && [ ! -f "/.dockerenv" ]; then
     docker run --rm \
         -v "$REPO_ROOT:/build" \
         -u "$(id -u):$(id -g)" \
+        -e DUCKER_PERF \
         -w /build \
         "$IMAGE_NAME" \
         ./scripts/build.sh
@@ -52,7 +54,7 @@ echo "Compiling DSP plugin..."
 ${CROSS_PREFIX}gcc -Ofast -shared -fPIC \
     -march=armv8-a -mtune=cortex-a72 \
     -fomit-frame-pointer -fno-stack-protector \
-    -DNDEBUG \
+    -DNDEBUG ${DUCKER_PERF:+-DDUCKER_PERF} \
     src/dsp/ducker.c \
     -o build/ducker.so \
     -Isrc/dsp \
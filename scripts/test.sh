@@ -0,0 +1,49 @@
+#!/usr/bin/env bash
+# Build and run the Ducker tests natively
+#
+# Compiles ducker.so with the host compiler and the same optimisation flags
+# as scripts/bench.sh, then builds and runs every tests/test_*.c against it.
+# Set CC to use a different compiler. Exits non-zero if any test fails.
+set -e
+
+SCRIPT_DIR="$(cd "$(dirname "$0")" && pwd)"
+REPO_ROOT="$(dirname "$SCRIPT_DIR")"
+CC="${CC:-gcc}"
+
+cd "$REPO_ROOT"
+
+echo "=== Building Ducker Tests ==="
+echo "Compiler: $CC"
+
+mkdir -p build/test
+
+${CC} -Ofast -shared -fPIC \
+    -fomit-frame-pointer -fno-stack-protector \
+    -DNDEBUG \
+    src/dsp/ducker.c \
+    -o build/test/ducker.so \
+    -Isrc/dsp \
+    -lm
+
+failed=0
+for src in tests/test_*.c; do
+    name="$(basename "$src" .c)"
+    ${CC} -O2 -Wall -Wextra \
+        "$src" \
+        -o "build/test/$name" \
+        -Isrc/dsp \
+        -ldl -lm
+
+    echo ""
+    echo "--- $name ---"
+    if ! "./build/test/$name" build/test/ducker.so; then
+        failed=1
+    fi
+done
+
+echo ""
+if [ "$failed" -ne 0 ]; then
+    echo "=== Tests FAILED ==="
+    exit 1
+fi
+echo "=== All tests passed ==="
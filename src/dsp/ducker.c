@@ -5,6 +5,13 @@
  * producing classic sidechain pumping without needing an audio sidechain input.
  *
  * Chain host discovers MIDI capability via dlsym("move_audio_fx_on_midi").
+ * Hosts that know each message's position in the block can use
+ * dlsym("move_audio_fx_on_midi_at") instead for sample-accurate triggering.
+ * Hosts running a float chain can process planar float32 audio through
+ * dlsym("move_audio_fx_process_f32") instead of process_block.
+ *
+ * Building with -DDUCKER_PERF times the process and MIDI entry points and
+ * reports the distribution through get_param("perf_stats").
  */
 
 #include <stdint.h>
@@ -12,10 +19,81 @@
 #include <string.h>
 #include <stdio.h>
 #include <math.h>
+#include <stdatomic.h>
 #include "audio_fx_api_v2.h"
 
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define DUCKER_NEON 1
+#endif
+
+#if defined(DUCKER_PERF) && !defined(__aarch64__)
+#include <time.h>
+#endif
+
 #define SAMPLE_RATE 44100
 
+/* Largest chunk rendered in one pass; longer host blocks are split */
+#define MAX_BLOCK_FRAMES MOVE_FRAMES_PER_BLOCK
+
+/* Lookahead delay line: up to 10ms, in stereo frames (power of two,
+ * at least the longest lookahead plus MAX_BLOCK_FRAMES) */
+#define LOOKAHEAD_MAX_MS 10.0f
+#define DELAY_FRAMES 1024
+
+/* Longest gain smoothing time constant */
+#define SMOOTHING_MAX_MS 10.0f
+
+/* Smoother reduction below this snaps to zero so idle can bypass */
+#define SMOOTHING_SETTLE 1e-5f
+
+/* Crossover frequency range, swept logarithmically */
+#define CROSSOVER_MIN_HZ 40.0f
+#define CROSSOVER_MAX_HZ 400.0f
+
+/* Envelope voice pool size (multiple of 4, at most 32) */
+#define MAX_VOICES 8
+
+/* Pending trigger events per instance */
+#define MAX_EVENTS 32
+
+/* Trigger map: extra "note:scale" entries beyond trigger_note */
+#define TRIGGER_MAP_MAX 16
+#define TRIGGER_SCALE_FULL 255    /* note_map depth scale for 1.0 */
+
+/* Modulation output: "target:param:depth" routes for the envelope */
+#define MOD_TARGETS_MAX 4
+#define MOD_NAME_SIZE 32
+#define MOD_EMIT_THRESHOLD (1.0f / 256.0f)   /* smallest change worth an emit */
+
+/* Envelope CC output: blocks between updates (~5.8ms, at most 2 packets
+ * each) */
+#define CC_INTERVAL_BLOCKS 2
+
+/* Gain-reduction telemetry: rings of one entry per block and one per
+ * HISTORY_DECIMATE blocks (sizes are powers of two) */
+#define METER_BLOCKS 16
+#define METER_WINDOW 6            /* blocks summarized by "meter", ~1 frame at 60fps */
+#define HISTORY_SIZE 128
+#define HISTORY_DECIMATE 8        /* ~23ms per entry, ~3s of history */
+
+/* Hot-path timing histogram (DUCKER_PERF builds): log-linear buckets with
+ * PERF_SUB_BITS of mantissa, i.e. within 12.5% of the true time */
+#define PERF_SUB_BITS 3
+#define PERF_BUCKETS 256
+
+/* Canonical string parameter capacity */
+#define SPARAM_SIZE 256
+
+/* Longest "state" JSON accepted by set_param; bounds parse time */
+#define STATE_JSON_MAX 4096
+
+/* Cached "state" JSON capacity */
+#define STATE_JSON_SIZE 2048
+
+/* Parameter command ring size (power of two) */
+#define PARAM_QUEUE_SIZE 64
+
 /* Envelope phases */
 enum {
     PHASE_IDLE = 0,
@@ -29,21 +107,220 @@ enum {
     CURVE_LINEAR = 0,
     CURVE_EXPO,
     CURVE_SCURVE,
-    CURVE_PUMP
+    CURVE_PUMP,
+    CURVE_COUNT
 };
 
+/*
+ * Curve lookup tables: one normalized 0→1 shape per curve (plus the pump
+ * release shape), CURVE_TABLE_SIZE segments with a guard point for
+ * interpolation. Ramps index them with a 32-bit phase where 2^32 == 1.0:
+ * the top CURVE_TABLE_BITS select the segment, the rest interpolate.
+ */
+#define CURVE_TABLE_BITS 10
+#define CURVE_TABLE_SIZE (1 << CURVE_TABLE_BITS)
+#define CURVE_FRAC_BITS (32 - CURVE_TABLE_BITS)
+#define CURVE_FRAC_MASK ((1u << CURVE_FRAC_BITS) - 1u)
+#define CURVE_TABLE_PUMP_RELEASE CURVE_COUNT
+
 /* Mode types */
 enum {
     MODE_TRIGGER = 0,
     MODE_GATE
 };
 
+/* Envelope voicing: one retriggered envelope, or a pool combined by min
+ * or product */
+enum {
+    VOICES_MONO = 0,
+    VOICES_MIN,
+    VOICES_PRODUCT
+};
+
+/* Envelope CC output destination and resolution */
+enum {
+    CC_OUT_OFF = 0,
+    CC_OUT_INTERNAL,
+    CC_OUT_EXTERNAL
+};
+
+enum {
+    CC_RES_7BIT = 0,
+    CC_RES_14BIT
+};
+
+/* Ducked band */
+enum {
+    BAND_FULL = 0,
+    BAND_LOW
+};
+
+/* Trigger key sources */
+enum {
+    KEY_MIDI = 0,
+    KEY_AUDIO
+};
+
+/* Parameter ids, used by the control→audio command queue */
+enum {
+    PARAM_CHANNEL = 0,
+    PARAM_TRIGGER_NOTE,
+    PARAM_MODE,
+    PARAM_DEPTH,
+    PARAM_ATTACK,
+    PARAM_HOLD,
+    PARAM_RELEASE,
+    PARAM_CURVE,
+    PARAM_VEL_SENS,
+    PARAM_SYNC,
+    PARAM_HOLD_DIV,
+    PARAM_RELEASE_DIV,
+    PARAM_SEQ,
+    PARAM_SEQ_STEPS,
+    PARAM_SEQ_PATTERN,
+    PARAM_KEY_SOURCE,
+    PARAM_THRESHOLD,
+    PARAM_LOOKAHEAD,
+    PARAM_SMOOTHING,
+    PARAM_BAND,
+    PARAM_CROSSOVER,
+    PARAM_VOICES,
+    PARAM_CC_OUT,
+    PARAM_CC_NUM,
+    PARAM_CC_CHANNEL,
+    PARAM_CC_RES,
+    PARAM_COUNT
+};
+
+/* Free-form string parameters, kept on the control thread and in "state" */
+enum {
+    SPARAM_TRIGGER_MAP = 0,
+    SPARAM_MOD_TARGETS,
+    SPARAM_COUNT
+};
+
+/* Parsed parameter change, produced by set_param, consumed by process_block */
+typedef struct param_cmd {
+    int id;               /* PARAM_* */
+    float value;          /* already parsed and clamped */
+} param_cmd_t;
+
+/* Trigger event, applied when rendering reaches its frame offset */
+typedef struct ducker_event {
+    int frame;            /* offset from the start of the next/current block */
+    uint8_t note_on;      /* 1=note on, 0=note off */
+    uint8_t velocity;     /* 1-127 for note on */
+    uint8_t scale;        /* depth scale for note on, TRIGGER_SCALE_FULL = 1.0 */
+} ducker_event_t;
+
+/* One modulation route and a published set of them */
+typedef struct mod_route {
+    char target[MOD_NAME_SIZE];
+    char param[MOD_NAME_SIZE];
+    float depth;          /* -1 to 1 */
+} mod_route_t;
+
+typedef struct mod_route_set {
+    int count;
+    mod_route_t routes[MOD_TARGETS_MAX];
+} mod_route_set_t;
+
+/* Set in mod_mid when the middle slot holds routes the audio thread lacks */
+#define MOD_SET_FRESH 4u
+
+/* Set in snap_mid when the middle slot holds a snapshot the audio thread lacks */
+#define SNAP_FRESH 4u
+
+#ifdef DUCKER_PERF
+/*
+ * Timing distribution for one entry point, in counter ticks. Written only
+ * by the audio thread; relaxed atomics let get_param read it without a
+ * data race, at the price of a snapshot that may be one call out of step.
+ */
+typedef struct perf_hist {
+    _Atomic uint32_t bucket[PERF_BUCKETS];
+    _Atomic uint64_t count;
+    _Atomic uint64_t min;
+    _Atomic uint64_t max;
+} perf_hist_t;
+
+#define PERF_BEGIN(t) uint64_t t = perf_now()
+#define PERF_END(hist, t) perf_record(&(hist), perf_now() - (t))
+#else
+#define PERF_BEGIN(t) ((void)0)
+#define PERF_END(hist, t) ((void)0)
+#endif
+
+/*
+ * Polyphonic envelope voices, structure-of-arrays so 4 voices fill one
+ * NEON register. Every voice is a ramp gain = base + span * table(acc):
+ * hold and idle voices have span 0 (idle: base 1, which is neutral for
+ * both min and product). table is a float offset into g_curve_tables.
+ */
+typedef struct voice_pool {
+    uint32_t acc[MAX_VOICES];
+    uint32_t inc[MAX_VOICES];
+    uint32_t table[MAX_VOICES];
+    float base[MAX_VOICES];
+    float span[MAX_VOICES];
+    float depth[MAX_VOICES];
+    int phase[MAX_VOICES];
+    int pos[MAX_VOICES];
+    int len[MAX_VOICES];
+    uint32_t mask;        /* bit v = voice v not idle */
+} voice_pool_t;
+
 typedef struct ducker_instance {
     char module_dir[512];
 
-    /* Parameters */
-    int channel;          /* 0=omni, 1-16 */
-    int trigger_note;     /* 0-127 */
+    /*
+     * Parameters as seen by the control thread (set_param/get_param),
+     * indexed by PARAM_*. The audio thread never reads these.
+     */
+    float ctl[PARAM_COUNT];
+
+    /*
+     * Pre-rendered "state" JSON. ctl_gen is bumped whenever ctl[] changes;
+     * the string is regenerated on the next read if state_gen lags behind.
+     */
+    char state_json[STATE_JSON_SIZE];
+    int state_len;
+    uint32_t ctl_gen;
+    uint32_t state_gen;
+
+    /* String parameters in canonical form, indexed by SPARAM_* */
+    char sparams[SPARAM_COUNT][SPARAM_SIZE];
+
+    /*
+     * Depth scale per MIDI channel (0-15) and note, 0 = not a trigger.
+     * Built from channel, trigger_note and trigger_map by the control
+     * thread, which stores only the entries that change; on_midi resolves
+     * a note with one relaxed load.
+     */
+    _Atomic uint8_t note_map[16][128];
+
+    /*
+     * Single-producer/single-consumer command ring. set_param parses and
+     * publishes commands by advancing cmd_head; process_block drains them
+     * at the top of each block and advances cmd_tail. cmd_resync is
+     * producer-only and set while an overflow snapshot is pending.
+     */
+    param_cmd_t cmd_ring[PARAM_QUEUE_SIZE];
+    _Atomic uint32_t cmd_head;
+    _Atomic uint32_t cmd_tail;
+    int cmd_resync;
+
+    /*
+     * Full copies of ctl[] for when the ring overflows, triple-buffered
+     * like mod_sets: the control thread fills ctl_snaps[snap_back] and
+     * swaps it into snap_mid; the audio thread takes it at its next drain.
+     */
+    float ctl_snaps[3][PARAM_COUNT];
+    _Atomic uint32_t snap_mid;
+    int snap_back;        /* control thread */
+    int snap_front;       /* audio thread */
+
+    /* Parameters (audio thread copy, updated from the command ring) */
     int mode;             /* MODE_TRIGGER or MODE_GATE */
     float depth;          /* 0.0-1.0 */
     float attack;         /* 0.0-1.0 → 0-50ms */
@@ -51,19 +328,138 @@ typedef struct ducker_instance {
     float release;        /* 0.0-1.0 → 0-1000ms */
     int curve;            /* CURVE_* */
     float vel_sens;       /* 0.0-1.0 */
+    int sync;             /* 1 = hold/release follow tempo as note divisions */
+    int hold_div;         /* index into g_div_beats */
+    int release_div;      /* index into g_div_beats */
+    int seq;              /* 1 = internal step sequencer drives triggers */
+    int seq_steps;        /* SEQ_STEPS_* */
+    int seq_pattern;      /* index into g_seq_patterns */
+    int key_source;       /* KEY_* */
+    float threshold;      /* audio key trigger level, int16 full scale */
+    int lookahead_len;    /* audio delay in samples; envelope runs this far ahead */
+    float smooth_coef;    /* one-pole coefficient, 0 = smoothing off */
+    int band;             /* BAND_* */
+    int voice_mode;       /* VOICES_* */
+    int cc_out;           /* CC_OUT_* */
+    int cc_num;           /* 0-119; 0-31 can send a 14-bit pair */
+    int cc_channel;       /* 1-16 */
+    int cc_res;           /* CC_RES_* */
+
+    /* Phase lengths in samples, recomputed only when lengths_dirty is set */
+    float bpm;            /* tempo the synced lengths were derived from */
+    int attack_len;
+    int hold_len;
+    int release_len;
+    int lengths_dirty;
 
     /* Envelope state */
     int phase;            /* PHASE_* */
     int phase_pos;        /* sample counter within phase */
     int phase_len;        /* total samples in current phase */
+    uint32_t phase_acc;   /* ramp position, 2^32 == 1.0 */
+    uint32_t phase_inc;   /* per-sample phase_acc step, 2^32 / phase_len */
     float vel_depth;      /* computed depth for current trigger */
     float envelope;       /* current envelope value: 1.0=pass, 0.0=max duck */
     int active_notes;     /* count of held notes (for gate mode) */
 
+    /* Voice pool, used instead of the envelope state above unless mono */
+    voice_pool_t voices;
+
+    /* Step sequencer, clocked by host MIDI clock; see run_sequencer() */
+    uint32_t seq_mask;    /* bit n = trigger on step n */
+    int seq_running;      /* following the clock: since start, or joined mid-song */
+    int seq_armed;        /* start/continue received, waiting for first tick */
+    int clock_running;    /* host reports its transport running, read per block */
+    int clock_ticks;      /* MIDI clock ticks received since start */
+    double seq_pos;       /* predicted clock position at block start, in ticks */
+    int seq_last_step;    /* last step index scheduled, -1 = none */
+
+    /* Audio key detector state; see run_detector() */
+    float det_level;      /* follower output, int16 full scale */
+    int det_armed;        /* 1 = next threshold crossing triggers */
+
+    /*
+     * Gain smoother: smooth_r is 1 - last output (exactly 0 when settled or
+     * off). smooth_decay/smooth_tap hold the one-pole unrolled over 4
+     * samples; see set_smoothing().
+     */
+    float smooth_r;
+    float smooth_decay[4];
+    float smooth_tap[4][4];
+
+    /*
+     * LR4 crossover: two cascaded Butterworth biquads (transposed direct
+     * form II), 4 lanes each as {low L, low R, high L, high R}. Coefficients
+     * are per lane and only recomputed when the frequency changes; see
+     * set_crossover().
+     */
+    float xo_b0[4], xo_b1[4], xo_b2[4], xo_a1[4], xo_a2[4];
+    float xo_z1[2][4];
+    float xo_z2[2][4];
+
+    /*
+     * Modulation routes, triple-buffered: the control thread fills
+     * mod_sets[mod_back] and swaps it into mod_mid; the audio thread swaps
+     * mod_mid with mod_front when MOD_SET_FRESH is set. Neither side ever
+     * touches a slot the other holds.
+     */
+    mod_route_set_t mod_sets[3];
+    _Atomic uint32_t mod_mid;
+    int mod_back;         /* control thread */
+    int mod_front;        /* audio thread */
+    char mod_source[MOD_NAME_SIZE];
+    float mod_sent;       /* gain reduction last emitted */
+    float gain_last;      /* gain at the end of the last rendered run */
+
+    /* Envelope CC output state; see publish_cc() */
+    int cc_wait;          /* blocks left before the next update */
+    int cc_sent_msb;      /* last value sent, -1 = resend */
+    int cc_sent_lsb;      /* last 14-bit LSB sent, -1 = resend */
+
+    /*
+     * Gain-reduction telemetry, written by the audio thread at the end of
+     * each block and read by get_param without locks. Every entry is one
+     * 64-bit word tagged with its sequence number (see meter_entry()), so a
+     * reader can always tell a stale or overwritten slot from a fresh one.
+     */
+    _Atomic uint64_t meter_ring[METER_BLOCKS];
+    _Atomic uint32_t meter_head;  /* blocks published */
+    _Atomic uint64_t hist_ring[HISTORY_SIZE];
+    _Atomic uint32_t hist_head;   /* history entries published */
+    float meter_min;      /* lowest gain rendered this block */
+    int meter_triggers;   /* note-ons applied this block */
+    uint32_t hist_gr;     /* peak over the history entry being built */
+    uint32_t hist_triggers;
+    int hist_blocks;
+
+#ifdef DUCKER_PERF
+    perf_hist_t perf_process;  /* process_block / process_f32 */
+    perf_hist_t perf_midi;     /* on_midi / on_midi_at */
+#endif
+
+    /*
+     * Lookahead delay lines: one packed stereo int16 frame per entry for
+     * process_block, planar L then R for the float32 entry point. Both
+     * advance delay_pos.
+     */
+    uint32_t *delay;
+    float *delay_f32;
+    uint32_t delay_pos;
+
+    /* Trigger events sorted by frame; see queue_event() */
+    ducker_event_t events[MAX_EVENTS];
+    int num_events;
+
+    /* Per-frame gain rendered by the envelope, consumed by apply_gain() */
+    float gain[MAX_BLOCK_FRAMES];
+
 } ducker_instance_t;
 
 static const host_api_v1_t *g_host = NULL;
 
+/* Shared by all instances; written once in move_audio_fx_init_v2 */
+static float g_curve_tables[CURVE_COUNT + 1][CURVE_TABLE_SIZE + 1];
+
 static void ducker_log(const char *msg) {
     if (g_host && g_host->log) {
         char buf[256];
@@ -72,36 +468,6 @@ static void ducker_log(const char *msg) {
     }
 }
 
-/* --- Tiny JSON helpers (no allocations) --- */
-
-static int json_get_number(const char *json, const char *key, float *out) {
-    char search[64];
-    snprintf(search, sizeof(search), "\"%s\":", key);
-    const char *p = strstr(json, search);
-    if (!p) return -1;
-    p += strlen(search);
-    while (*p == ' ' || *p == '\t') p++;
-    *out = (float)atof(p);
-    return 0;
-}
-
-static int json_get_string(const char *json, const char *key, char *out, int out_len) {
-    char search[64];
-    snprintf(search, sizeof(search), "\"%s\":", key);
-    const char *p = strstr(json, search);
-    if (!p) return -1;
-    p += strlen(search);
-    while (*p == ' ' || *p == '\t') p++;
-    if (*p != '"') return -1;
-    p++;
-    int i = 0;
-    while (*p && *p != '"' && i < out_len - 1) {
-        out[i++] = *p++;
-    }
-    out[i] = '\0';
-    return 0;
-}
-
 /* --- Envelope helpers --- */
 
 static inline float clampf(float x, float lo, float hi) {
@@ -110,431 +476,2714 @@ static inline float clampf(float x, float lo, float hi) {
     return x;
 }
 
+/* Built with -Ofast, so isfinite() folds to 1 and NaN slips through
+ * clampf; test the exponent bits instead */
+static inline int is_finite_f(float x) {
+    uint32_t bits;
+    memcpy(&bits, &x, sizeof(bits));
+    return (bits & 0x7F800000u) != 0x7F800000u;
+}
+
 static int ms_to_samples(float ms) {
     return (int)(ms * (SAMPLE_RATE / 1000.0f));
 }
 
-static int attack_samples(ducker_instance_t *inst) {
-    return ms_to_samples(inst->attack * 50.0f);  /* 0-50ms */
-}
+/* Tempo-sync note divisions, in beats (quarter notes) */
+#define NUM_DIVS 11
+static const char *const g_div_names[NUM_DIVS] = {
+    "1/2", "1/4D", "1/4", "1/4T", "1/8D", "1/8", "1/8T", "1/16D", "1/16", "1/16T", "1/32"
+};
+static const float g_div_beats[NUM_DIVS] = {
+    2.0f, 1.5f, 1.0f, 2.0f / 3.0f, 0.75f, 0.5f, 1.0f / 3.0f, 0.375f, 0.25f, 1.0f / 6.0f, 0.125f
+};
 
-static int hold_samples(ducker_instance_t *inst) {
-    return ms_to_samples(inst->hold * 500.0f);   /* 0-500ms */
-}
+/* Recompute cached phase lengths after a parameter or tempo change */
+static void update_lengths(ducker_instance_t *inst) {
+    inst->attack_len = ms_to_samples(inst->attack * 50.0f);  /* 0-50ms */
+
+    if (inst->sync) {
+        float beat = (float)SAMPLE_RATE * 60.0f / inst->bpm;
+        inst->hold_len = (int)(g_div_beats[inst->hold_div] * beat);
+        inst->release_len = (int)(g_div_beats[inst->release_div] * beat);
+    } else {
+        inst->hold_len = ms_to_samples(inst->hold * 500.0f);        /* 0-500ms */
+        inst->release_len = ms_to_samples(inst->release * 1000.0f); /* 0-1000ms */
+    }
 
-static int release_samples(ducker_instance_t *inst) {
-    return ms_to_samples(inst->release * 1000.0f); /* 0-1000ms */
+    inst->lengths_dirty = 0;
 }
 
 /*
- * Shape a 0-1 time value using the selected curve.
+ * Fill the curve tables. Each maps t in 0→1 to a shaped 0→1 value.
  * For attack: t goes 0→1 as we duck DOWN (envelope goes 1→0)
  * For release: t goes 0→1 as we recover UP (envelope goes 0→1)
  */
-static float shape_curve(int curve, float t, int is_release) {
-    t = clampf(t, 0.0f, 1.0f);
+static void init_curve_tables(void) {
+    for (int i = 0; i <= CURVE_TABLE_SIZE; i++) {
+        float t = (float)i / (float)CURVE_TABLE_SIZE;
+        float inv = 1.0f - t;
+
+        g_curve_tables[CURVE_LINEAR][i] = t;
+        g_curve_tables[CURVE_EXPO][i] = t * t;
+        g_curve_tables[CURVE_SCURVE][i] = t * t * (3.0f - 2.0f * t);
+        g_curve_tables[CURVE_PUMP][i] = t;  /* Linear attack for pump */
+        /* Cubic ease-out with slight overshoot feel */
+        g_curve_tables[CURVE_TABLE_PUMP_RELEASE][i] = 1.0f - inv * inv * inv;
+    }
+}
 
-    switch (curve) {
-    case CURVE_EXPO:
-        return t * t;
+static const float *curve_table(int curve, int is_release) {
+    if (curve < 0 || curve >= CURVE_COUNT) curve = CURVE_LINEAR;
+    if (curve == CURVE_PUMP && is_release) return g_curve_tables[CURVE_TABLE_PUMP_RELEASE];
+    return g_curve_tables[curve];
+}
 
-    case CURVE_SCURVE:
-        return t * t * (3.0f - 2.0f * t);
+/*
+ * Reset the ramp phase for a new attack/release of phase_len samples.
+ * The increment is truncated so the accumulator never wraps; the drift after
+ * k samples is below k / 2^32 of full scale (< 1e-5 for a 1s ramp),
+ * and the last sample of each phase is pinned to its exact target level.
+ */
+static void start_ramp(ducker_instance_t *inst) {
+    inst->phase_acc = 0;
+    inst->phase_inc = (inst->phase_len > 0)
+        ? (uint32_t)(((uint64_t)1 << 32) / (uint64_t)inst->phase_len)
+        : 0;
+}
 
-    case CURVE_PUMP:
-        if (is_release) {
-            /* Cubic ease-out with slight overshoot feel */
-            float inv = 1.0f - t;
-            return 1.0f - inv * inv * inv;
-        }
-        return t;  /* Linear attack for pump */
+static void start_release(ducker_instance_t *inst) {
+    inst->phase = PHASE_RELEASE;
+    inst->phase_pos = 0;
+    inst->phase_len = inst->release_len;
+    start_ramp(inst);
+    if (inst->phase_len <= 0) {
+        inst->phase = PHASE_IDLE;
+        inst->envelope = 1.0f;
+    }
+}
 
-    case CURVE_LINEAR:
-    default:
-        return t;
+static void start_hold(ducker_instance_t *inst) {
+    inst->envelope = 1.0f - inst->vel_depth;
+    inst->phase = PHASE_HOLD;
+    inst->phase_pos = 0;
+    inst->phase_len = inst->hold_len;
+    if (inst->phase_len <= 0 && inst->mode == MODE_TRIGGER) {
+        /* Zero hold in trigger mode - jump to release */
+        start_release(inst);
     }
 }
 
 static void start_attack(ducker_instance_t *inst) {
     inst->phase = PHASE_ATTACK;
     inst->phase_pos = 0;
-    inst->phase_len = attack_samples(inst);
+    inst->phase_len = inst->attack_len;
+    start_ramp(inst);
     if (inst->phase_len <= 0) {
         /* Zero attack - jump straight to hold */
-        inst->envelope = 1.0f - inst->vel_depth;
-        inst->phase = PHASE_HOLD;
-        inst->phase_pos = 0;
-        inst->phase_len = hold_samples(inst);
-        if (inst->phase_len <= 0 && inst->mode == MODE_TRIGGER) {
-            /* Zero hold in trigger mode - jump to release */
-            inst->phase = PHASE_RELEASE;
-            inst->phase_pos = 0;
-            inst->phase_len = release_samples(inst);
-        }
+        start_hold(inst);
     }
 }
 
-static void start_release(ducker_instance_t *inst) {
-    inst->phase = PHASE_RELEASE;
-    inst->phase_pos = 0;
-    inst->phase_len = release_samples(inst);
-    if (inst->phase_len <= 0) {
-        inst->phase = PHASE_IDLE;
-        inst->envelope = 1.0f;
+/* --- Voice pool --- */
+
+static void voice_idle(ducker_instance_t *inst, int v) {
+    voice_pool_t *vp = &inst->voices;
+    vp->phase[v] = PHASE_IDLE;
+    vp->acc[v] = 0;
+    vp->inc[v] = 0;
+    vp->base[v] = 1.0f;
+    vp->span[v] = 0.0f;
+    vp->mask &= ~(1u << v);
+}
+
+/* Same ramp setup as start_ramp(), for one voice */
+static void voice_ramp(ducker_instance_t *inst, int v, int is_release, float base, float span) {
+    voice_pool_t *vp = &inst->voices;
+    vp->pos[v] = 0;
+    vp->acc[v] = 0;
+    vp->inc[v] = (vp->len[v] > 0)
+        ? (uint32_t)(((uint64_t)1 << 32) / (uint64_t)vp->len[v])
+        : 0;
+    vp->table[v] = (uint32_t)(curve_table(inst->curve, is_release) - g_curve_tables[0]);
+    vp->base[v] = base;
+    vp->span[v] = span;
+}
+
+static void voice_release(ducker_instance_t *inst, int v) {
+    voice_pool_t *vp = &inst->voices;
+    vp->phase[v] = PHASE_RELEASE;
+    vp->len[v] = inst->release_len;
+    if (vp->len[v] <= 0) {
+        voice_idle(inst, v);
+        return;
     }
+    voice_ramp(inst, v, 1, 1.0f - vp->depth[v], vp->depth[v]);
 }
 
-/* --- Audio FX API v2 implementation --- */
+static void voice_hold(ducker_instance_t *inst, int v) {
+    voice_pool_t *vp = &inst->voices;
+    vp->phase[v] = PHASE_HOLD;
+    vp->len[v] = inst->hold_len;
+    if (vp->len[v] <= 0 && inst->mode == MODE_TRIGGER) {
+        voice_release(inst, v);
+        return;
+    }
+    vp->pos[v] = 0;
+    vp->inc[v] = 0;
+    vp->base[v] = 1.0f - vp->depth[v];
+    vp->span[v] = 0.0f;
+}
 
-static void* v2_create_instance(const char *module_dir, const char *config_json) {
-    ducker_log("Creating instance");
+static void voice_attack(ducker_instance_t *inst, int v, float depth) {
+    voice_pool_t *vp = &inst->voices;
+    vp->mask |= 1u << v;
+    vp->depth[v] = depth;
+    vp->phase[v] = PHASE_ATTACK;
+    vp->len[v] = inst->attack_len;
+    if (vp->len[v] <= 0) {
+        voice_hold(inst, v);
+        return;
+    }
+    voice_ramp(inst, v, 0, 1.0f, -depth);
+}
 
-    ducker_instance_t *inst = (ducker_instance_t *)calloc(1, sizeof(ducker_instance_t));
-    if (!inst) {
-        ducker_log("Failed to allocate instance");
-        return NULL;
+/*
+ * Pick a voice for a new trigger: the first idle one, otherwise the voice
+ * closest to unity (the least audible to cut short). Always O(MAX_VOICES).
+ */
+static int voice_claim(ducker_instance_t *inst) {
+    voice_pool_t *vp = &inst->voices;
+    if (vp->mask != (uint32_t)((1ull << MAX_VOICES) - 1)) {
+        for (int v = 0; v < MAX_VOICES; v++) {
+            if (!(vp->mask & (1u << v))) return v;
+        }
     }
 
-    if (module_dir) {
-        strncpy(inst->module_dir, module_dir, sizeof(inst->module_dir) - 1);
+    int best = 0;
+    float best_level = -1.0f;
+    for (int v = 0; v < MAX_VOICES; v++) {
+        const float *table = g_curve_tables[0] + vp->table[v];
+        float level = vp->base[v] + vp->span[v] * table[vp->acc[v] >> CURVE_FRAC_BITS];
+        if (level > best_level) {
+            best_level = level;
+            best = v;
+        }
     }
+    return best;
+}
 
-    /* Defaults */
-    inst->channel = 1;        /* Channel 1 */
-    inst->trigger_note = 36;  /* C1 */
-    inst->mode = MODE_TRIGGER;
-    inst->depth = 1.0f;
-    inst->attack = 0.1f;      /* 5ms */
-    inst->hold = 0.2f;        /* 100ms */
-    inst->release = 0.3f;     /* 300ms */
-    inst->curve = CURVE_LINEAR;
-    inst->vel_sens = 0.0f;
+/* Switching voicing drops any envelope in flight */
+static void set_voice_mode(ducker_instance_t *inst, int mode) {
+    if (mode == inst->voice_mode) return;
+    inst->voice_mode = mode;
     inst->phase = PHASE_IDLE;
     inst->envelope = 1.0f;
-    inst->active_notes = 0;
+    for (int v = 0; v < MAX_VOICES; v++) voice_idle(inst, v);
+}
 
-    ducker_log("Instance created");
-    return inst;
+static int envelope_idle(const ducker_instance_t *inst) {
+    if (inst->voice_mode != VOICES_MONO) return inst->voices.mask == 0;
+    return inst->phase == PHASE_IDLE;
 }
 
-static void v2_destroy_instance(void *instance) {
-    ducker_instance_t *inst = (ducker_instance_t *)instance;
-    if (!inst) return;
-    ducker_log("Destroying instance");
-    free(inst);
+/* --- Trigger events --- */
+
+static void note_on(ducker_instance_t *inst, uint8_t vel, uint8_t scale) {
+    inst->active_notes++;
+
+    /* Compute velocity-scaled depth */
+    float vel_scale = 1.0f;
+    if (inst->vel_sens > 0.0f) {
+        vel_scale = 1.0f - inst->vel_sens + inst->vel_sens * (vel / 127.0f);
+    }
+    inst->vel_depth = inst->depth * vel_scale;
+
+    /* Per-note depth from the trigger map; full scale stays exact */
+    if (scale != TRIGGER_SCALE_FULL) {
+        inst->vel_depth *= (float)scale * (1.0f / (float)TRIGGER_SCALE_FULL);
+    }
+
+    if (inst->voice_mode != VOICES_MONO) {
+        /* Overlapping triggers each get their own envelope */
+        voice_attack(inst, voice_claim(inst), inst->vel_depth);
+        return;
+    }
+    start_attack(inst);
 }
 
-static void v2_process_block(void *instance, int16_t *audio_inout, int frames) {
-    ducker_instance_t *inst = (ducker_instance_t *)instance;
-    if (!inst) return;
+static void note_off(ducker_instance_t *inst) {
+    if (inst->active_notes > 0) inst->active_notes--;
 
-    for (int i = 0; i < frames; i++) {
-        /* Advance envelope */
-        switch (inst->phase) {
-        case PHASE_ATTACK: {
-            if (inst->phase_len > 0) {
-                float t = (float)inst->phase_pos / (float)inst->phase_len;
-                float shaped = shape_curve(inst->curve, t, 0);
-                /* Attack ducks down: envelope goes from 1.0 to (1.0 - vel_depth) */
-                inst->envelope = 1.0f - inst->vel_depth * shaped;
-            }
-            inst->phase_pos++;
-            if (inst->phase_pos >= inst->phase_len) {
-                inst->envelope = 1.0f - inst->vel_depth;
-                inst->phase = PHASE_HOLD;
-                inst->phase_pos = 0;
-                inst->phase_len = hold_samples(inst);
-                if (inst->phase_len <= 0 && inst->mode == MODE_TRIGGER) {
-                    inst->phase = PHASE_RELEASE;
-                    inst->phase_pos = 0;
-                    inst->phase_len = release_samples(inst);
-                }
-            }
-            break;
-        }
-        case PHASE_HOLD: {
-            /* Stay at ducked level */
-            inst->envelope = 1.0f - inst->vel_depth;
-            inst->phase_pos++;
-            if (inst->mode == MODE_TRIGGER && inst->phase_pos >= inst->phase_len) {
-                /* In trigger mode, hold expires → release */
-                inst->phase = PHASE_RELEASE;
-                inst->phase_pos = 0;
-                inst->phase_len = release_samples(inst);
-            }
-            /* In gate mode, hold stays until note-off triggers release */
-            break;
-        }
-        case PHASE_RELEASE: {
-            if (inst->phase_len > 0) {
-                float t = (float)inst->phase_pos / (float)inst->phase_len;
-                float shaped = shape_curve(inst->curve, t, 1);
-                /* Release recovers: envelope goes from (1.0 - vel_depth) to 1.0 */
-                inst->envelope = (1.0f - inst->vel_depth) + inst->vel_depth * shaped;
-            }
-            inst->phase_pos++;
-            if (inst->phase_pos >= inst->phase_len) {
-                inst->phase = PHASE_IDLE;
-                inst->envelope = 1.0f;
+    if (inst->mode == MODE_GATE && inst->active_notes == 0) {
+        /* Gate mode: release on last note-off */
+        if (inst->voice_mode != VOICES_MONO) {
+            for (int v = 0; v < MAX_VOICES; v++) {
+                int phase = inst->voices.phase[v];
+                if (phase == PHASE_HOLD || phase == PHASE_ATTACK) voice_release(inst, v);
             }
-            break;
-        }
-        case PHASE_IDLE:
-        default:
-            /* envelope stays at 1.0 (pass-through) */
-            break;
+        } else if (inst->phase == PHASE_HOLD || inst->phase == PHASE_ATTACK) {
+            start_release(inst);
         }
+    }
+}
 
-        /* Apply gain */
-        float gain = inst->envelope;
-        float l = (float)audio_inout[i * 2] * gain;
-        float r = (float)audio_inout[i * 2 + 1] * gain;
+static void apply_event(ducker_instance_t *inst, const ducker_event_t *ev) {
+    if (ev->note_on) {
+        inst->meter_triggers++;
+        note_on(inst, ev->velocity, ev->scale);
+    } else {
+        note_off(inst);
+    }
+}
 
-        /* Clamp to int16 range */
-        if (l > 32767.0f) l = 32767.0f;
-        if (l < -32768.0f) l = -32768.0f;
-        if (r > 32767.0f) r = 32767.0f;
-        if (r < -32768.0f) r = -32768.0f;
+/*
+ * Queue a trigger event at a frame offset into the next process_block.
+ * Offsets past the end of that block carry over into later blocks. Events
+ * at the same offset keep arrival order. If the queue is full, whichever
+ * event is earliest (the new one or the head of the queue) is applied
+ * immediately, i.e. at the start of the next block. Nothing is dropped and
+ * the queue still drains in time order, so a note-off can't overtake the
+ * queued note-ons before it and leave the gate stuck down.
+ */
+static void queue_event(ducker_instance_t *inst, int frame, int note_on, uint8_t vel,
+                        uint8_t scale) {
+    ducker_event_t ev;
+    ev.frame = (frame > 0) ? frame : 0;
+    ev.note_on = (uint8_t)(note_on ? 1 : 0);
+    ev.velocity = vel;
+    ev.scale = scale;
+
+    if (inst->num_events >= MAX_EVENTS) {
+        if (ev.frame < inst->events[0].frame) {
+            apply_event(inst, &ev);
+            return;
+        }
+        apply_event(inst, &inst->events[0]);
+        inst->num_events--;
+        memmove(inst->events, inst->events + 1,
+                (size_t)inst->num_events * sizeof(ducker_event_t));
+    }
 
-        audio_inout[i * 2] = (int16_t)l;
-        audio_inout[i * 2 + 1] = (int16_t)r;
+    int i = inst->num_events;
+    while (i > 0 && inst->events[i - 1].frame > ev.frame) {
+        inst->events[i] = inst->events[i - 1];
+        i--;
     }
+    inst->events[i] = ev;
+    inst->num_events++;
 }
 
-/* --- MIDI handler (exported via dlsym for chain host) --- */
+/* Apply every queued event due at or before frame */
+static void apply_due_events(ducker_instance_t *inst, int frame) {
+    int done = 0;
+    while (done < inst->num_events && inst->events[done].frame <= frame) {
+        apply_event(inst, &inst->events[done]);
+        done++;
+    }
+    if (done > 0) {
+        inst->num_events -= done;
+        memmove(inst->events, inst->events + done,
+                (size_t)inst->num_events * sizeof(ducker_event_t));
+    }
+}
 
-static void ducker_on_midi(void *instance, const uint8_t *msg, int len, int source) {
-    ducker_instance_t *inst = (ducker_instance_t *)instance;
-    if (!inst || len < 3) return;
+/* --- Step sequencer --- */
 
-    uint8_t status = msg[0] & 0xF0;
-    uint8_t ch = (msg[0] & 0x0F) + 1;  /* 1-16 */
-    uint8_t note = msg[1];
-    uint8_t vel = msg[2];
+#define CLOCKS_PER_STEP 6      /* 24 ppqn MIDI clock, 16th-note steps */
+#define SEQ_RESYNC_TICKS 3.0   /* larger clock error snaps the prediction */
+#define SEQ_CORRECTION 0.25    /* fraction of smaller errors corrected per block */
+
+/* Step counts */
+enum {
+    SEQ_STEPS_16 = 0,
+    SEQ_STEPS_32
+};
 
-    /* Channel filter: 0=omni accepts all */
-    if (inst->channel > 0 && ch != inst->channel) return;
+/* Preset patterns: trigger on steps where step % interval == offset */
+typedef struct seq_pattern {
+    int interval;
+    int offset;
+} seq_pattern_t;
+
+/* Same order as g_seq_pattern_names */
+#define NUM_SEQ_PATTERNS 8
+static const seq_pattern_t g_seq_patterns[NUM_SEQ_PATTERNS] = {
+    {  4, 0 },   /* Quarters: four on the floor */
+    {  2, 0 },   /* Eighths */
+    {  4, 2 },   /* Offbeats */
+    {  8, 4 },   /* Backbeat */
+    {  8, 0 },   /* Halves */
+    {  1, 0 },   /* 16ths */
+    {  3, 0 },   /* Dotted 8 */
+    { 16, 0 },   /* Bars */
+};
 
-    /* Note filter */
-    if (note != inst->trigger_note) return;
+static int seq_length(const ducker_instance_t *inst) {
+    return (inst->seq_steps == SEQ_STEPS_32) ? 32 : 16;
+}
 
-    if (status == 0x90 && vel > 0) {
-        /* Note on */
-        inst->active_notes++;
+static void update_seq_mask(ducker_instance_t *inst) {
+    const seq_pattern_t *pat = &g_seq_patterns[inst->seq_pattern];
+    uint32_t mask = 0;
+    for (int step = 0; step < seq_length(inst); step++) {
+        if (step % pat->interval == pat->offset) mask |= 1u << step;
+    }
+    inst->seq_mask = mask;
+}
 
-        /* Compute velocity-scaled depth */
-        float vel_scale = 1.0f;
-        if (inst->vel_sens > 0.0f) {
-            vel_scale = 1.0f - inst->vel_sens + inst->vel_sens * (vel / 127.0f);
+/* MIDI realtime messages from the host clock */
+static void seq_on_realtime(ducker_instance_t *inst, uint8_t status) {
+    switch (status) {
+    case 0xFA:  /* Start: next tick is step 0 */
+        inst->clock_ticks = 0;
+        inst->seq_pos = 0.0;
+        inst->seq_last_step = -1;
+        inst->seq_running = 0;
+        inst->seq_armed = 1;
+        break;
+    case 0xFB:  /* Continue from the current position */
+        inst->seq_armed = 1;
+        break;
+    case 0xFC:  /* Stop */
+        inst->seq_running = 0;
+        inst->seq_armed = 0;
+        break;
+    case 0xF8:  /* Clock tick */
+        if (inst->seq_armed) {
+            inst->seq_armed = 0;
+            inst->seq_running = 1;
+        } else if (inst->seq_running) {
+            inst->clock_ticks++;
+        } else if (inst->clock_running) {
+            /* Transport already playing but no Start seen (created or
+             * loaded mid-song): join, with this tick as step 0 */
+            inst->clock_ticks = 0;
+            inst->seq_pos = 0.0;
+            inst->seq_last_step = -1;
+            inst->seq_running = 1;
         }
-        inst->vel_depth = inst->depth * vel_scale;
+        break;
+    default:
+        break;
+    }
+}
 
-        start_attack(inst);
+/*
+ * Schedule this block's sequencer steps as trigger events at exact frame
+ * offsets. The clock position is predicted from the tempo; received ticks
+ * only say it lies within [clock_ticks, clock_ticks + 1), so the prediction
+ * is nudged back when it drifts outside that window and snapped when it is
+ * far off. Steps therefore land between ticks instead of on block starts.
+ * seq_last_step keeps a step from firing twice after a backwards correction.
+ */
+static void run_sequencer(ducker_instance_t *inst, int frames) {
+    double spt = (double)SAMPLE_RATE * 60.0 / ((double)inst->bpm * 24.0);
+    double lo = (double)inst->clock_ticks;
+    double hi = lo + 1.0;
+
+    if (inst->seq_pos < lo - SEQ_RESYNC_TICKS || inst->seq_pos > hi + SEQ_RESYNC_TICKS) {
+        inst->seq_pos = lo;
+    } else if (inst->seq_pos < lo) {
+        inst->seq_pos += (lo - inst->seq_pos) * SEQ_CORRECTION;
+    } else if (inst->seq_pos > hi) {
+        inst->seq_pos -= (inst->seq_pos - hi) * SEQ_CORRECTION;
     }
-    else if (status == 0x80 || (status == 0x90 && vel == 0)) {
-        /* Note off */
-        if (inst->active_notes > 0) inst->active_notes--;
 
-        if (inst->mode == MODE_GATE && inst->active_notes == 0) {
-            /* Gate mode: release on last note-off */
-            if (inst->phase == PHASE_HOLD || inst->phase == PHASE_ATTACK) {
-                start_release(inst);
-            }
+    double end = inst->seq_pos + (double)frames / spt;
+    int step = (int)ceil(inst->seq_pos / CLOCKS_PER_STEP);
+    if (step <= inst->seq_last_step) step = inst->seq_last_step + 1;
+
+    for (; (double)step * CLOCKS_PER_STEP < end; step++) {
+        int frame = (int)(((double)step * CLOCKS_PER_STEP - inst->seq_pos) * spt);
+        if (frame < 0) frame = 0;
+        if (frame >= frames) frame = frames - 1;
+
+        if (inst->seq_mask & (1u << (step % seq_length(inst)))) {
+            /* Gate length of half a step for gate mode */
+            int gate = (int)(spt * CLOCKS_PER_STEP * 0.5);
+            queue_event(inst, frame, 1, 127, TRIGGER_SCALE_FULL);
+            queue_event(inst, frame + gate, 0, 0, 0);
         }
+        inst->seq_last_step = step;
     }
+
+    inst->seq_pos = end;
 }
 
-/* --- Parameter handling --- */
+/* --- Audio key detector --- */
 
-static int parse_channel(const char *val) {
-    if (strcmp(val, "Omni") == 0) return 0;
-    int ch = atoi(val);
-    if (ch >= 1 && ch <= 16) return ch;
-    /* Float 0-1 → 0-16 */
-    float f = (float)atof(val);
-    return (int)(f * 16.0f + 0.5f);
+/*
+ * The detector runs at a decimated control rate: one peak per DETECT_DECIM
+ * frames of host input, then attack/release ballistics on those peaks.
+ * Crossing the threshold queues a trigger at that chunk's frame offset; it
+ * re-arms once the level falls DETECT_HYSTERESIS below the threshold.
+ */
+#define DETECT_DECIM 8
+#define DETECT_ATTACK_COEF 0.166f   /* ~1ms at 44100/8 Hz */
+#define DETECT_RELEASE_COEF 0.0036f /* ~50ms at 44100/8 Hz */
+#define DETECT_HYSTERESIS 0.5f      /* -6dB re-arm level */
+
+/* Peak |sample| over DETECT_DECIM stereo frames */
+static inline int detect_peak(const int16_t *in) {
+#ifdef DUCKER_NEON
+    int16x8_t a = vqabsq_s16(vld1q_s16(in));
+    int16x8_t b = vqabsq_s16(vld1q_s16(in + 8));
+    int16x8_t m = vmaxq_s16(a, b);
+    int16x4_t m4 = vpmax_s16(vget_low_s16(m), vget_high_s16(m));
+    m4 = vpmax_s16(m4, m4);
+    m4 = vpmax_s16(m4, m4);
+    return vget_lane_s16(m4, 0);
+#else
+    int peak = 0;
+    for (int i = 0; i < DETECT_DECIM * 2; i++) {
+        int v = in[i] < 0 ? -in[i] : in[i];
+        if (v > peak) peak = v;
+    }
+    return peak;
+#endif
 }
 
-static int parse_curve(const char *val) {
-    if (strcmp(val, "Linear") == 0) return CURVE_LINEAR;
-    if (strcmp(val, "Expo") == 0) return CURVE_EXPO;
-    if (strcmp(val, "S-Curve") == 0) return CURVE_SCURVE;
-    if (strcmp(val, "Pump") == 0) return CURVE_PUMP;
-    /* Numeric fallback */
-    int idx = (int)(atof(val) * 3.0f + 0.5f);
-    if (idx < 0) idx = 0;
-    if (idx > 3) idx = 3;
-    return idx;
+static void run_detector(ducker_instance_t *inst, int frames) {
+    if (!g_host || !g_host->mapped_memory) return;
+
+    const int16_t *in = (const int16_t *)(g_host->mapped_memory + g_host->audio_in_offset);
+    if (frames > MOVE_FRAMES_PER_BLOCK) frames = MOVE_FRAMES_PER_BLOCK;
+
+    float level = inst->det_level;
+    for (int f = 0; f + DETECT_DECIM <= frames; f += DETECT_DECIM) {
+        float peak = (float)detect_peak(in + f * 2);
+        float coef = (peak > level) ? DETECT_ATTACK_COEF : DETECT_RELEASE_COEF;
+        level += (peak - level) * coef;
+
+        if (inst->det_armed && level >= inst->threshold) {
+            /* Louder hits duck harder when velocity sensitivity is on */
+            int vel = 1 + (int)(126.0f * clampf(level / 32767.0f, 0.0f, 1.0f));
+            queue_event(inst, f, 1, (uint8_t)vel, TRIGGER_SCALE_FULL);
+            inst->det_armed = 0;
+        } else if (!inst->det_armed && level < inst->threshold * DETECT_HYSTERESIS) {
+            queue_event(inst, f, 0, 0, 0);
+            inst->det_armed = 1;
+        }
+    }
+    inst->det_level = level;
 }
 
-static int parse_mode(const char *val) {
-    if (strcmp(val, "Trigger") == 0) return MODE_TRIGGER;
-    if (strcmp(val, "Gate") == 0) return MODE_GATE;
-    return (atof(val) > 0.5f) ? MODE_GATE : MODE_TRIGGER;
+/* --- Gain smoothing --- */
+
+/*
+ * Set the smoother time constant (0-1 → 0-10ms) and precompute the 4-sample
+ * unrolled form of y[n] = y[n-1] + a * (x[n] - y[n-1]):
+ *
+ *   y[k] = d^(k+1) * y[-1] + sum(j <= k) a * d^(k-j) * x[j],   d = 1 - a
+ *
+ * smooth_decay[k] is d^(k+1); smooth_tap[j][k] is x[j]'s weight in y[k].
+ */
+static void set_smoothing(ducker_instance_t *inst, float value) {
+    float tau = value * SMOOTHING_MAX_MS * (SAMPLE_RATE / 1000.0f);
+    if (tau < 1.0f) {
+        /* Off (or shorter than a sample): drop any residual smoothing */
+        inst->smooth_coef = 0.0f;
+        inst->smooth_r = 0.0f;
+        return;
+    }
+
+    float a = 1.0f - expf(-1.0f / tau);
+    float d = 1.0f - a;
+    float dk = 1.0f;
+    float pow_d[4];
+    for (int k = 0; k < 4; k++) {
+        pow_d[k] = dk;
+        dk *= d;
+        inst->smooth_decay[k] = dk;
+    }
+    for (int j = 0; j < 4; j++) {
+        for (int k = 0; k < 4; k++) {
+            inst->smooth_tap[j][k] = (k >= j) ? a * pow_d[k - j] : 0.0f;
+        }
+    }
+    inst->smooth_coef = a;
 }
 
-static void v2_set_param(void *instance, const char *key, const char *val) {
-    ducker_instance_t *inst = (ducker_instance_t *)instance;
-    if (!inst || !key || !val) return;
+/*
+ * One-pole low-pass over the rendered gain, in place. The filter runs on the
+ * gain reduction (1 - gain) so the state decays geometrically to zero;
+ * filtering the gain itself stalls a few ulps short of 1.0 in float.
+ * The recursion is serial, so the NEON path steps 4 samples at a time using
+ * the unrolled coefficients: one multiply and four lane multiply-accumulates
+ * per group, with only the last lane carried into the next. The scalar loop
+ * handles the tail (and everything on non-NEON builds).
+ */
+static void smooth_gain(ducker_instance_t *inst, float *gain, int frames) {
+    float r = inst->smooth_r;
+    int i = 0;
 
-    if (strcmp(key, "channel") == 0) {
-        inst->channel = parse_channel(val);
-    } else if (strcmp(key, "trigger_note") == 0) {
-        int n = atoi(val);
-        if (n < 0) n = 0;
-        if (n > 127) n = 127;
-        inst->trigger_note = n;
-    } else if (strcmp(key, "mode") == 0) {
-        inst->mode = parse_mode(val);
-    } else if (strcmp(key, "depth") == 0) {
-        inst->depth = clampf((float)atof(val), 0.0f, 1.0f);
-    } else if (strcmp(key, "attack") == 0) {
-        inst->attack = clampf((float)atof(val), 0.0f, 1.0f);
-    } else if (strcmp(key, "hold") == 0) {
-        inst->hold = clampf((float)atof(val), 0.0f, 1.0f);
-    } else if (strcmp(key, "release") == 0) {
-        inst->release = clampf((float)atof(val), 0.0f, 1.0f);
-    } else if (strcmp(key, "curve") == 0) {
-        inst->curve = parse_curve(val);
-    } else if (strcmp(key, "vel_sens") == 0) {
-        inst->vel_sens = clampf((float)atof(val), 0.0f, 1.0f);
-    } else if (strcmp(key, "state") == 0) {
-        /* Restore all parameters from JSON state */
-        float fval;
-        char sval[32];
+#ifdef DUCKER_NEON
+    float32x4_t decay = vld1q_f32(inst->smooth_decay);
+    float32x4_t tap0 = vld1q_f32(inst->smooth_tap[0]);
+    float32x4_t tap1 = vld1q_f32(inst->smooth_tap[1]);
+    float32x4_t tap2 = vld1q_f32(inst->smooth_tap[2]);
+    float32x4_t tap3 = vld1q_f32(inst->smooth_tap[3]);
+    const float32x4_t one = vdupq_n_f32(1.0f);
+    for (; i + 4 <= frames; i += 4) {
+        float32x4_t x = vsubq_f32(one, vld1q_f32(gain + i));
+        float32x2_t x_lo = vget_low_f32(x);
+        float32x2_t x_hi = vget_high_f32(x);
+        float32x4_t out = vmulq_n_f32(decay, r);
+        out = vmlaq_lane_f32(out, tap0, x_lo, 0);
+        out = vmlaq_lane_f32(out, tap1, x_lo, 1);
+        out = vmlaq_lane_f32(out, tap2, x_hi, 0);
+        out = vmlaq_lane_f32(out, tap3, x_hi, 1);
+        vst1q_f32(gain + i, vsubq_f32(one, out));
+        r = vgetq_lane_f32(out, 3);
+    }
+#endif
 
-        if (json_get_string(val, "channel", sval, sizeof(sval)) == 0) {
-            inst->channel = parse_channel(sval);
-        } else if (json_get_number(val, "channel", &fval) == 0) {
-            inst->channel = (int)clampf(fval, 0.0f, 16.0f);
-        }
-        if (json_get_number(val, "trigger_note", &fval) == 0) {
-            inst->trigger_note = (int)clampf(fval, 0.0f, 127.0f);
-        }
-        if (json_get_string(val, "mode", sval, sizeof(sval)) == 0) {
-            inst->mode = parse_mode(sval);
-        } else if (json_get_number(val, "mode", &fval) == 0) {
-            inst->mode = (int)clampf(fval, 0.0f, 1.0f);
-        }
-        if (json_get_number(val, "depth", &fval) == 0) {
-            inst->depth = clampf(fval, 0.0f, 1.0f);
-        }
-        if (json_get_number(val, "attack", &fval) == 0) {
-            inst->attack = clampf(fval, 0.0f, 1.0f);
-        }
-        if (json_get_number(val, "hold", &fval) == 0) {
-            inst->hold = clampf(fval, 0.0f, 1.0f);
-        }
-        if (json_get_number(val, "release", &fval) == 0) {
-            inst->release = clampf(fval, 0.0f, 1.0f);
-        }
-        if (json_get_string(val, "curve", sval, sizeof(sval)) == 0) {
-            inst->curve = parse_curve(sval);
-        } else if (json_get_number(val, "curve", &fval) == 0) {
-            inst->curve = (int)clampf(fval, 0.0f, 3.0f);
-        }
-        if (json_get_number(val, "vel_sens", &fval) == 0) {
-            inst->vel_sens = clampf(fval, 0.0f, 1.0f);
-        }
+    const float a = inst->smooth_coef;
+    for (; i < frames; i++) {
+        r += a * ((1.0f - gain[i]) - r);
+        gain[i] = 1.0f - r;
     }
+
+    inst->smooth_r = r;
 }
 
-static const char *channel_name(int ch) {
-    static const char *names[] = {
-        "Omni", "1", "2", "3", "4", "5", "6", "7", "8",
-        "9", "10", "11", "12", "13", "14", "15", "16"
-    };
-    if (ch < 0 || ch > 16) return "Omni";
-    return names[ch];
+/* --- Crossover --- */
+
+/*
+ * Set the crossover frequency (0-1 → 40-400Hz, logarithmic). Each LR4 band
+ * is a 2nd-order Butterworth (Q = 1/sqrt(2)) squared, so both stages share
+ * the same coefficients: lowpass in lanes 0-1, highpass in lanes 2-3.
+ */
+static void set_crossover(ducker_instance_t *inst, float value) {
+    float hz = CROSSOVER_MIN_HZ * powf(CROSSOVER_MAX_HZ / CROSSOVER_MIN_HZ, value);
+    float w0 = 6.28318531f * hz / (float)SAMPLE_RATE;
+    float cw = cosf(w0);
+    float alpha = sinf(w0) * 0.70710678f;    /* sin(w0) / (2Q) */
+    float norm = 1.0f / (1.0f + alpha);
+
+    float lp_b0 = (1.0f - cw) * 0.5f * norm;
+    float hp_b0 = (1.0f + cw) * 0.5f * norm;
+    float a1 = -2.0f * cw * norm;
+    float a2 = (1.0f - alpha) * norm;
+
+    for (int k = 0; k < 4; k++) {
+        float b0 = (k < 2) ? lp_b0 : hp_b0;
+        inst->xo_b0[k] = b0;
+        inst->xo_b1[k] = (k < 2) ? 2.0f * b0 : -2.0f * b0;
+        inst->xo_b2[k] = b0;
+        inst->xo_a1[k] = a1;
+        inst->xo_a2[k] = a2;
+    }
+}
+
+static void set_band(ducker_instance_t *inst, int band) {
+    /* Start the filters from rest rather than from stale state */
+    if (band == BAND_LOW && inst->band != BAND_LOW) {
+        memset(inst->xo_z1, 0, sizeof(inst->xo_z1));
+        memset(inst->xo_z2, 0, sizeof(inst->xo_z2));
+    }
+    inst->band = band;
 }
 
-static const char *curve_name(int curve) {
-    static const char *names[] = { "Linear", "Expo", "S-Curve", "Pump" };
-    if (curve < 0 || curve > 3) return "Linear";
-    return names[curve];
+/*
+ * Feedback keeps a NaN or inf in the filter state forever, pinning the
+ * output at full scale; start the filters from rest if that has happened.
+ */
+static void xo_check_state(ducker_instance_t *inst) {
+    const float *z1 = &inst->xo_z1[0][0];
+    const float *z2 = &inst->xo_z2[0][0];
+    int finite = 1;
+    for (int k = 0; k < 8; k++) finite &= is_finite_f(z1[k]) & is_finite_f(z2[k]);
+    if (!finite) {
+        memset(inst->xo_z1, 0, sizeof(inst->xo_z1));
+        memset(inst->xo_z2, 0, sizeof(inst->xo_z2));
+    }
 }
 
-static const char *mode_name(int mode) {
-    return (mode == MODE_GATE) ? "Gate" : "Trigger";
+/* --- MIDI CC output --- */
+
+/* New destination or format: send the current value on the next block */
+static void reset_cc(ducker_instance_t *inst) {
+    inst->cc_wait = 0;
+    inst->cc_sent_msb = -1;
+    inst->cc_sent_lsb = -1;
 }
 
-static int v2_get_param(void *instance, const char *key, char *buf, int buf_len) {
-    ducker_instance_t *inst = (ducker_instance_t *)instance;
-    if (!inst) return -1;
+/* Queue one CC as a USB-MIDI packet (cable 0); returns 0 if it was refused */
+static int send_cc(const ducker_instance_t *inst, int cc, int value) {
+    uint8_t pkt[4] = {
+        0x0B,                                       /* cable 0, CIN control change */
+        (uint8_t)(0xB0 | ((inst->cc_channel - 1) & 0x0F)),
+        (uint8_t)cc,
+        (uint8_t)value
+    };
+    int (*send)(const uint8_t *msg, int len) = (inst->cc_out == CC_OUT_INTERNAL)
+        ? g_host->midi_send_internal
+        : g_host->midi_send_external;
+    return send && send(pkt, 4) > 0;
+}
 
-    if (strcmp(key, "channel") == 0) return snprintf(buf, buf_len, "%s", channel_name(inst->channel));
-    if (strcmp(key, "trigger_note") == 0) return snprintf(buf, buf_len, "%d", inst->trigger_note);
-    if (strcmp(key, "mode") == 0) return snprintf(buf, buf_len, "%s", mode_name(inst->mode));
-    if (strcmp(key, "depth") == 0) return snprintf(buf, buf_len, "%.2f", inst->depth);
-    if (strcmp(key, "attack") == 0) return snprintf(buf, buf_len, "%.2f", inst->attack);
-    if (strcmp(key, "hold") == 0) return snprintf(buf, buf_len, "%.2f", inst->hold);
-    if (strcmp(key, "release") == 0) return snprintf(buf, buf_len, "%.2f", inst->release);
-    if (strcmp(key, "curve") == 0) return snprintf(buf, buf_len, "%s", curve_name(inst->curve));
-    if (strcmp(key, "vel_sens") == 0) return snprintf(buf, buf_len, "%.2f", inst->vel_sens);
-    if (strcmp(key, "name") == 0) return snprintf(buf, buf_len, "DUCKER");
+/*
+ * Stream the gain reduction (0 = no duck, 127 or 16383 = full) as a CC.
+ * Updates go out at most every CC_INTERVAL_BLOCKS blocks and only when the
+ * quantized value changed, so one update is at most 2 packets (MSB, then
+ * LSB for 14-bit pairs on CC 0-31). A refused packet is not retried until
+ * the next block, so a full host queue never stalls the audio thread.
+ */
+static void publish_cc(ducker_instance_t *inst) {
+    if (inst->cc_out == CC_OUT_OFF || !g_host) return;
+    if (inst->cc_wait > 0) {
+        inst->cc_wait--;
+        return;
+    }
 
-    if (strcmp(key, "state") == 0) {
-        return snprintf(buf, buf_len,
-            "{\"channel\":%d,\"trigger_note\":%d,\"mode\":%d,"
-            "\"depth\":%.3f,\"attack\":%.3f,\"hold\":%.3f,\"release\":%.3f,"
-            "\"curve\":%d,\"vel_sens\":%.3f}",
-            inst->channel, inst->trigger_note, inst->mode,
-            inst->depth, inst->attack, inst->hold, inst->release,
-            inst->curve, inst->vel_sens);
-    }
-
-    if (strcmp(key, "ui_hierarchy") == 0) {
-        const char *hierarchy = "{"
-            "\"modes\":null,"
-            "\"levels\":{"
-                "\"root\":{"
-                    "\"children\":null,"
-                    "\"knobs\":[\"channel\",\"trigger_note\",\"mode\",\"depth\",\"attack\",\"hold\",\"release\",\"curve\"],"
-                    "\"params\":[\"channel\",\"trigger_note\",\"mode\",\"depth\",\"attack\",\"hold\",\"release\",\"curve\",\"vel_sens\"]"
-                "}"
-            "}"
-        "}";
-        int len = strlen(hierarchy);
-        if (len < buf_len) {
-            strcpy(buf, hierarchy);
-            return len;
-        }
-        return -1;
+    float gr = 1.0f - inst->gain_last;
+    int fine = (inst->cc_res == CC_RES_14BIT && inst->cc_num < 32);
+    int msb, lsb = 0;
+    if (fine) {
+        int v = (int)lrintf(gr * 16383.0f);
+        msb = v >> 7;
+        lsb = v & 0x7F;
+    } else {
+        msb = (int)lrintf(gr * 127.0f);
     }
 
-    if (strcmp(key, "chain_params") == 0) {
-        const char *params_json = "["
-            "{\"key\":\"channel\",\"name\":\"Channel\",\"type\":\"enum\",\"options\":[\"Omni\",\"1\",\"2\",\"3\",\"4\",\"5\",\"6\",\"7\",\"8\",\"9\",\"10\",\"11\",\"12\",\"13\",\"14\",\"15\",\"16\"],\"default\":\"1\"},"
-            "{\"key\":\"trigger_note\",\"name\":\"Trigger\",\"type\":\"int\",\"min\":0,\"max\":127,\"default\":36,\"step\":1},"
-            "{\"key\":\"mode\",\"name\":\"Mode\",\"type\":\"enum\",\"options\":[\"Trigger\",\"Gate\"],\"default\":\"Trigger\"},"
-            "{\"key\":\"depth\",\"name\":\"Depth\",\"type\":\"float\",\"min\":0,\"max\":1,\"default\":1,\"step\":0.01},"
-            "{\"key\":\"attack\",\"name\":\"Attack\",\"type\":\"float\",\"min\":0,\"max\":1,\"default\":0.1,\"step\":0.01},"
-            "{\"key\":\"hold\",\"name\":\"Hold\",\"type\":\"float\",\"min\":0,\"max\":1,\"default\":0.2,\"step\":0.01},"
-            "{\"key\":\"release\",\"name\":\"Release\",\"type\":\"float\",\"min\":0,\"max\":1,\"default\":0.3,\"step\":0.01},"
-            "{\"key\":\"curve\",\"name\":\"Curve\",\"type\":\"enum\",\"options\":[\"Linear\",\"Expo\",\"S-Curve\",\"Pump\"],\"default\":\"Linear\"}"
-        "]";
-        int len = strlen(params_json);
-        if (len < buf_len) {
-            strcpy(buf, params_json);
-            return len;
-        }
-        return -1;
+    int sent = 0;
+    if (msb != inst->cc_sent_msb) {
+        if (!send_cc(inst, inst->cc_num, msb)) return;
+        inst->cc_sent_msb = msb;
+        inst->cc_sent_lsb = -1;    /* receivers clear the LSB on a new MSB */
+        sent = 1;
+    }
+    if (fine && lsb != inst->cc_sent_lsb && send_cc(inst, inst->cc_num + 32, lsb)) {
+        inst->cc_sent_lsb = lsb;
+        sent = 1;
     }
 
-    return -1;
+    if (sent) inst->cc_wait = CC_INTERVAL_BLOCKS - 1;
 }
 
-/* --- API exports --- */
+/* --- Telemetry --- */
 
-static audio_fx_api_v2_t g_fx_api_v2;
+static const char *const g_phase_names[] = { "Idle", "Attack", "Hold", "Release" };
 
-audio_fx_api_v2_t* move_audio_fx_init_v2(const host_api_v1_t *host) {
-    g_host = host;
+_Static_assert(ATOMIC_LLONG_LOCK_FREE == 2, "telemetry rings need lock-free 64-bit atomics");
 
-    memset(&g_fx_api_v2, 0, sizeof(g_fx_api_v2));
-    g_fx_api_v2.api_version = AUDIO_FX_API_VERSION_2;
-    g_fx_api_v2.create_instance = v2_create_instance;
-    g_fx_api_v2.destroy_instance = v2_destroy_instance;
+/* Ring entry: sequence number in the high word, then phase, triggers and
+ * gain reduction (0-65535) */
+static inline uint64_t meter_entry(uint32_t seq, int phase, uint32_t triggers, uint32_t gr) {
+    if (triggers > 255) triggers = 255;
+    return ((uint64_t)seq << 32) | ((uint32_t)phase << 24) | (triggers << 16) | gr;
+}
+
+#define ENTRY_PHASE(e)    ((int)(((e) >> 24) & 0xFF))
+#define ENTRY_TRIGGERS(e) ((uint32_t)(((e) >> 16) & 0xFF))
+#define ENTRY_GR(e)       ((uint32_t)((e) & 0xFFFF))
+
+/* Envelope phase for telemetry; with a voice pool, the earliest any voice is in */
+static int meter_phase(const ducker_instance_t *inst) {
+    if (inst->voice_mode == VOICES_MONO) return inst->phase;
+
+    int phase = PHASE_IDLE;
+    for (uint32_t m = inst->voices.mask; m; m &= m - 1) {
+        int p = inst->voices.phase[__builtin_ctz(m)];
+        if (phase == PHASE_IDLE || p < phase) phase = p;
+    }
+    return phase;
+}
+
+/*
+ * Publish this block's peak gain reduction, trigger count and phase, and
+ * fold them into the history entry being built. Costs a few stores per
+ * block; readers never make the audio thread wait or do extra work.
+ */
+static void publish_meter(ducker_instance_t *inst) {
+    uint32_t gr = (uint32_t)lrintf(clampf(1.0f - inst->meter_min, 0.0f, 1.0f) * 65535.0f);
+    uint32_t triggers = (uint32_t)inst->meter_triggers;
+    int phase = meter_phase(inst);
+    inst->meter_min = 1.0f;
+    inst->meter_triggers = 0;
+
+    uint32_t head = atomic_load_explicit(&inst->meter_head, memory_order_relaxed);
+    atomic_store_explicit(&inst->meter_ring[head & (METER_BLOCKS - 1)],
+                          meter_entry(head, phase, triggers, gr), memory_order_relaxed);
+    atomic_store_explicit(&inst->meter_head, head + 1, memory_order_release);
+
+    if (gr > inst->hist_gr) inst->hist_gr = gr;
+    inst->hist_triggers += triggers;
+    if (++inst->hist_blocks < HISTORY_DECIMATE) return;
+
+    head = atomic_load_explicit(&inst->hist_head, memory_order_relaxed);
+    atomic_store_explicit(&inst->hist_ring[head & (HISTORY_SIZE - 1)],
+                          meter_entry(head, phase, inst->hist_triggers, inst->hist_gr),
+                          memory_order_relaxed);
+    atomic_store_explicit(&inst->hist_head, head + 1, memory_order_release);
+    inst->hist_gr = 0;
+    inst->hist_triggers = 0;
+    inst->hist_blocks = 0;
+}
+
+/*
+ * Copy up to max of the newest entries of a telemetry ring into out, oldest
+ * first, and store the published count in *head. Entries the writer
+ * overwrote during the copy fail their sequence check and are dropped, so
+ * the result is always a consistent run ending at the newest entry.
+ */
+static int read_ring(_Atomic uint64_t *ring, _Atomic uint32_t *head_ptr, uint32_t size,
+                     uint64_t *out, int max, uint32_t *head) {
+    uint32_t h = atomic_load_explicit(head_ptr, memory_order_acquire);
+    uint32_t n = (h < (uint32_t)max) ? h : (uint32_t)max;
+    *head = h;
+
+    int count = 0;
+    for (uint32_t seq = h - n; seq != h; seq++) {
+        uint64_t e = atomic_load_explicit(&ring[seq & (size - 1)], memory_order_relaxed);
+        if ((uint32_t)(e >> 32) != seq) {
+            count = 0;     /* overwritten: keep only what follows */
+            continue;
+        }
+        out[count++] = e;
+    }
+    return count;
+}
+
+/*
+ * "meter": the newest block and a summary of the last METER_WINDOW blocks,
+ * e.g. {"block":1234,"gr":0.412,"peak":0.873,"triggers":1,"phase":"Release"}.
+ * gr and peak are gain reduction, 0 = none, 1 = full depth.
+ */
+static int format_meter(ducker_instance_t *inst, char *buf, int buf_len) {
+    uint64_t e[METER_WINDOW];
+    uint32_t head;
+    int n = read_ring(inst->meter_ring, &inst->meter_head, METER_BLOCKS, e, METER_WINDOW, &head);
+
+    uint32_t peak = 0, triggers = 0;
+    for (int i = 0; i < n; i++) {
+        if (ENTRY_GR(e[i]) > peak) peak = ENTRY_GR(e[i]);
+        triggers += ENTRY_TRIGGERS(e[i]);
+    }
+    uint64_t last = n ? e[n - 1] : 0;
+
+    int len = snprintf(buf, buf_len,
+                       "{\"block\":%u,\"gr\":%.3f,\"peak\":%.3f,\"triggers\":%u,\"phase\":\"%s\"}",
+                       head, ENTRY_GR(last) / 65535.0f, peak / 65535.0f, triggers,
+                       g_phase_names[ENTRY_PHASE(last) & 3]);
+    return (len < buf_len) ? len : -1;
+}
+
+/*
+ * "gr_history": peak gain reduction (0-255) and trigger count per
+ * HISTORY_DECIMATE blocks, oldest first, e.g.
+ * {"entry":310,"blocks":8,"gr":[0,0,255,198],"triggers":[0,0,1,0]}.
+ */
+static int format_gr_history(ducker_instance_t *inst, char *buf, int buf_len) {
+    uint64_t e[HISTORY_SIZE];
+    uint32_t head;
+    int n = read_ring(inst->hist_ring, &inst->hist_head, HISTORY_SIZE, e, HISTORY_SIZE, &head);
+
+    int len = snprintf(buf, buf_len, "{\"entry\":%u,\"blocks\":%d,\"gr\":[",
+                       head, HISTORY_DECIMATE);
+    for (int i = 0; i < n && len < buf_len; i++) {
+        len += snprintf(buf + len, buf_len - len, i ? ",%u" : "%u",
+                        (ENTRY_GR(e[i]) * 255u + 32767u) / 65535u);
+    }
+    if (len < buf_len) len += snprintf(buf + len, buf_len - len, "],\"triggers\":[");
+    for (int i = 0; i < n && len < buf_len; i++) {
+        len += snprintf(buf + len, buf_len - len, i ? ",%u" : "%u", ENTRY_TRIGGERS(e[i]));
+    }
+    if (len < buf_len) len += snprintf(buf + len, buf_len - len, "]}");
+    return (len < buf_len) ? len : -1;
+}
+
+/* --- Hot-path timing --- */
+
+#ifdef DUCKER_PERF
+/* Virtual counter on aarch64 (the isb keeps earlier work from leaking past
+ * the read), monotonic nanoseconds elsewhere */
+static inline uint64_t perf_now(void) {
+#if defined(__aarch64__)
+    uint64_t t;
+    __asm__ volatile("isb\n\tmrs %0, cntvct_el0" : "=r"(t) : : "memory");
+    return t;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+#endif
+}
+
+static uint64_t perf_hz(void) {
+#if defined(__aarch64__)
+    uint64_t hz;
+    __asm__ volatile("mrs %0, cntfrq_el0" : "=r"(hz));
+    return hz;
+#else
+    return 1000000000u;
+#endif
+}
+
+/* Exact below 2^PERF_SUB_BITS, then PERF_SUB_BITS of mantissa per octave */
+static inline int perf_bucket(uint64_t t) {
+    const int sub = 1 << PERF_SUB_BITS;
+    if (t < (uint64_t)sub) return (int)t;
+    int e = 63 - __builtin_clzll(t);
+    int b = (e - PERF_SUB_BITS + 1) * sub + (int)((t >> (e - PERF_SUB_BITS)) & (sub - 1));
+    return (b < PERF_BUCKETS) ? b : PERF_BUCKETS - 1;
+}
+
+/* Smallest time that lands in bucket b */
+static uint64_t perf_bucket_floor(int b) {
+    const int sub = 1 << PERF_SUB_BITS;
+    if (b < sub) return (uint64_t)b;
+    int e = b / sub + PERF_SUB_BITS - 1;
+    return (uint64_t)(sub + b % sub) << (e - PERF_SUB_BITS);
+}
+
+/* Single writer, so plain load/store pairs instead of read-modify-writes */
+static inline void perf_record(perf_hist_t *h, uint64_t t) {
+    _Atomic uint32_t *b = &h->bucket[perf_bucket(t)];
+    atomic_store_explicit(b, atomic_load_explicit(b, memory_order_relaxed) + 1,
+                          memory_order_relaxed);
+
+    uint64_t n = atomic_load_explicit(&h->count, memory_order_relaxed);
+    if (n == 0 || t < atomic_load_explicit(&h->min, memory_order_relaxed)) {
+        atomic_store_explicit(&h->min, t, memory_order_relaxed);
+    }
+    if (t > atomic_load_explicit(&h->max, memory_order_relaxed)) {
+        atomic_store_explicit(&h->max, t, memory_order_relaxed);
+    }
+    atomic_store_explicit(&h->count, n + 1, memory_order_relaxed);
+}
+
+/* Lower bound of the bucket holding the q-th fraction of recorded calls */
+static uint64_t perf_percentile(const uint32_t *buckets, uint64_t total, double q) {
+    uint64_t rank = (uint64_t)ceil(q * (double)total);
+    if (rank == 0) rank = 1;
+    uint64_t seen = 0;
+    for (int b = 0; b < PERF_BUCKETS; b++) {
+        seen += buckets[b];
+        if (seen >= rank) return perf_bucket_floor(b);
+    }
+    return perf_bucket_floor(PERF_BUCKETS - 1);
+}
+
+static int format_perf_hist(perf_hist_t *h, char *buf, int buf_len) {
+    uint32_t buckets[PERF_BUCKETS];
+    uint64_t total = 0;
+    for (int b = 0; b < PERF_BUCKETS; b++) {
+        buckets[b] = atomic_load_explicit(&h->bucket[b], memory_order_relaxed);
+        total += buckets[b];
+    }
+    if (total == 0) return snprintf(buf, buf_len, "{\"count\":0}");
+
+    return snprintf(buf, buf_len,
+                    "{\"count\":%llu,\"min\":%llu,\"p50\":%llu,\"p99\":%llu,\"max\":%llu}",
+                    (unsigned long long)total,
+                    (unsigned long long)atomic_load_explicit(&h->min, memory_order_relaxed),
+                    (unsigned long long)perf_percentile(buckets, total, 0.50),
+                    (unsigned long long)perf_percentile(buckets, total, 0.99),
+                    (unsigned long long)atomic_load_explicit(&h->max, memory_order_relaxed));
+}
+
+/*
+ * "perf_stats": per-call time of the process and MIDI entry points since
+ * the instance was created, in ticks of hz (p50/p99 are bucket lower
+ * bounds), plus MIDI events per processed block, e.g.
+ * {"hz":54000000,"process":{"count":..,"min":..,"p50":..,"p99":..,"max":..},
+ *  "midi":{...},"events_per_block":0.25}
+ */
+static int format_perf_stats(ducker_instance_t *inst, char *buf, int buf_len) {
+    char process[160], midi[160];
+    format_perf_hist(&inst->perf_process, process, sizeof(process));
+    format_perf_hist(&inst->perf_midi, midi, sizeof(midi));
+
+    uint64_t blocks = atomic_load_explicit(&inst->perf_process.count, memory_order_relaxed);
+    uint64_t events = atomic_load_explicit(&inst->perf_midi.count, memory_order_relaxed);
+
+    int len = snprintf(buf, buf_len,
+                       "{\"hz\":%llu,\"process\":%s,\"midi\":%s,\"events_per_block\":%.3f}",
+                       (unsigned long long)perf_hz(), process, midi,
+                       blocks ? (double)events / (double)blocks : 0.0);
+    return (len < buf_len) ? len : -1;
+}
+#endif
+
+/* --- Parameter descriptors --- */
+
+/* Parameter value types */
+enum {
+    PTYPE_INT = 0,
+    PTYPE_FLOAT,
+    PTYPE_ENUM
+};
+
+typedef struct param_desc param_desc_t;
+
+/*
+ * One entry per parameter, indexed by PARAM_*. parse turns a set_param
+ * string into a clamped value (control thread only); format renders a value
+ * for get_param. Values are stored as float; ints and enum indices are exact.
+ */
+struct param_desc {
+    const char *key;
+    const char *label;                     /* UI name for chain_params */
+    int type;                              /* PTYPE_* */
+    float min;
+    float max;
+    float def;
+    const char *const *options;            /* PTYPE_ENUM only */
+    int (*parse)(const param_desc_t *d, const char *val, float *out);
+    int (*format)(const param_desc_t *d, float value, char *buf, int buf_len);
+};
+
+static const char *const g_channel_names[] = {
+    "Omni", "1", "2", "3", "4", "5", "6", "7", "8",
+    "9", "10", "11", "12", "13", "14", "15", "16"
+};
+static const char *const g_mode_names[] = { "Trigger", "Gate" };
+static const char *const g_curve_names[] = { "Linear", "Expo", "S-Curve", "Pump" };
+static const char *const g_off_on_names[] = { "Off", "On" };
+static const char *const g_seq_steps_names[] = { "16", "32" };
+static const char *const g_key_names[] = { "MIDI", "Audio" };
+
+static const char *const g_band_names[] = { "Full", "Low" };
+
+static const char *const g_voice_names[] = { "Mono", "Min", "Product" };
+
+static const char *const g_cc_out_names[] = { "Off", "Internal", "External" };
+
+static const char *const g_cc_res_names[] = { "7-bit", "14-bit" };
+
+static const char *const g_seq_pattern_names[NUM_SEQ_PATTERNS] = {
+    "Quarters", "Eighths", "Offbeats", "Backbeat", "Halves", "16ths", "Dotted 8", "Bars"
+};
+
+/*
+ * Value parsers store the parsed value in *out and return 1, or return 0
+ * to reject the text and leave the parameter unchanged.
+ */
+
+/* atof() that rejects nan, inf and overflow such as 1e999 */
+static int parse_number(const char *val, float *out) {
+    float f = (float)atof(val);
+    if (!is_finite_f(f)) return 0;
+    *out = f;
+    return 1;
+}
+
+static int parse_channel(const param_desc_t *d, const char *val, float *out) {
+    (void)d;
+    if (strcmp(val, "Omni") == 0) {
+        *out = 0.0f;
+        return 1;
+    }
+    int ch = atoi(val);
+    if (ch >= 1 && ch <= 16) {
+        *out = (float)ch;
+        return 1;
+    }
+    /* Float 0-1 → 0-16 */
+    float f;
+    if (!parse_number(val, &f)) return 0;
+    *out = (float)(int)(clampf(f, 0.0f, 1.0f) * 16.0f + 0.5f);
+    return 1;
+}
+
+static int parse_curve(const param_desc_t *d, const char *val, float *out) {
+    (void)d;
+    if (strcmp(val, "Linear") == 0) *out = CURVE_LINEAR;
+    else if (strcmp(val, "Expo") == 0) *out = CURVE_EXPO;
+    else if (strcmp(val, "S-Curve") == 0) *out = CURVE_SCURVE;
+    else if (strcmp(val, "Pump") == 0) *out = CURVE_PUMP;
+    else {
+        /* Numeric fallback */
+        float f;
+        if (!parse_number(val, &f)) return 0;
+        *out = (float)(int)(clampf(f, 0.0f, 1.0f) * 3.0f + 0.5f);
+    }
+    return 1;
+}
+
+static int parse_mode(const param_desc_t *d, const char *val, float *out) {
+    (void)d;
+    if (strcmp(val, "Trigger") == 0) *out = MODE_TRIGGER;
+    else if (strcmp(val, "Gate") == 0) *out = MODE_GATE;
+    else *out = (atof(val) > 0.5f) ? MODE_GATE : MODE_TRIGGER;
+    return 1;
+}
+
+/* Enum by option name, or a 0-1 float as fallback (as parse_curve) */
+static int parse_option(const param_desc_t *d, const char *val, float *out) {
+    int count = (int)d->max + 1;
+    for (int i = 0; i < count; i++) {
+        if (strcmp(val, d->options[i]) == 0) {
+            *out = (float)i;
+            return 1;
+        }
+    }
+    float f;
+    if (!parse_number(val, &f)) return 0;
+    *out = (float)(int)(clampf(f, 0.0f, 1.0f) * d->max + 0.5f);
+    return 1;
+}
+
+static int parse_int(const param_desc_t *d, const char *val, float *out) {
+    *out = clampf((float)atoi(val), d->min, d->max);
+    return 1;
+}
+
+static int parse_float(const param_desc_t *d, const char *val, float *out) {
+    float f;
+    if (!parse_number(val, &f)) return 0;
+    *out = clampf(f, d->min, d->max);
+    return 1;
+}
+
+static int format_enum(const param_desc_t *d, float value, char *buf, int buf_len) {
+    int idx = (int)value;
+    if (idx < (int)d->min || idx > (int)d->max) idx = (int)d->def;
+    return snprintf(buf, buf_len, "%s", d->options[idx]);
+}
+
+static int format_int(const param_desc_t *d, float value, char *buf, int buf_len) {
+    (void)d;
+    return snprintf(buf, buf_len, "%d", (int)value);
+}
+
+static int format_float(const param_desc_t *d, float value, char *buf, int buf_len) {
+    (void)d;
+    return snprintf(buf, buf_len, "%.2f", value);
+}
+
+static const param_desc_t g_params[PARAM_COUNT] = {
+    [PARAM_CHANNEL]      = { "channel",      "Channel",     PTYPE_ENUM,  0.0f,  16.0f,  1.0f, g_channel_names, parse_channel, format_enum },
+    [PARAM_TRIGGER_NOTE] = { "trigger_note", "Trigger",     PTYPE_INT,   0.0f, 127.0f, 36.0f, NULL,            parse_int,     format_int },
+    [PARAM_MODE]         = { "mode",         "Mode",        PTYPE_ENUM,  0.0f,   1.0f,  0.0f, g_mode_names,    parse_mode,    format_enum },
+    [PARAM_DEPTH]        = { "depth",        "Depth",       PTYPE_FLOAT, 0.0f,   1.0f,  1.0f, NULL,            parse_float,   format_float },
+    [PARAM_ATTACK]       = { "attack",       "Attack",      PTYPE_FLOAT, 0.0f,   1.0f,  0.1f, NULL,            parse_float,   format_float },  /* 5ms */
+    [PARAM_HOLD]         = { "hold",         "Hold",        PTYPE_FLOAT, 0.0f,   1.0f,  0.2f, NULL,            parse_float,   format_float },  /* 100ms */
+    [PARAM_RELEASE]      = { "release",      "Release",     PTYPE_FLOAT, 0.0f,   1.0f,  0.3f, NULL,            parse_float,   format_float },  /* 300ms */
+    [PARAM_CURVE]        = { "curve",        "Curve",       PTYPE_ENUM,  0.0f,   3.0f,  0.0f, g_curve_names,   parse_curve,   format_enum },
+    [PARAM_VEL_SENS]     = { "vel_sens",     "Vel Sens",    PTYPE_FLOAT, 0.0f,   1.0f,  0.0f, NULL,            parse_float,   format_float },
+    [PARAM_SYNC]         = { "sync",         "Sync",        PTYPE_ENUM,  0.0f,   1.0f,  0.0f, g_off_on_names,  parse_option,  format_enum },
+    [PARAM_HOLD_DIV]     = { "hold_div",     "Hold Div",    PTYPE_ENUM,  0.0f,  10.0f,  8.0f, g_div_names,     parse_option,  format_enum },  /* 1/16 */
+    [PARAM_RELEASE_DIV]  = { "release_div",  "Rel Div",     PTYPE_ENUM,  0.0f,  10.0f,  5.0f, g_div_names,     parse_option,  format_enum },  /* 1/8 */
+    [PARAM_SEQ]          = { "seq",          "Sequencer",   PTYPE_ENUM,  0.0f,   1.0f,  0.0f, g_off_on_names,  parse_option,  format_enum },
+    [PARAM_SEQ_STEPS]    = { "seq_steps",    "Steps",       PTYPE_ENUM,  0.0f,   1.0f,  0.0f, g_seq_steps_names, parse_option, format_enum },
+    [PARAM_SEQ_PATTERN]  = { "seq_pattern",  "Pattern",     PTYPE_ENUM,  0.0f,   7.0f,  0.0f, g_seq_pattern_names, parse_option, format_enum },
+    [PARAM_KEY_SOURCE]   = { "key_source",   "Key",         PTYPE_ENUM,  0.0f,   1.0f,  0.0f, g_key_names,     parse_option,  format_enum },
+    [PARAM_THRESHOLD]    = { "threshold",    "Threshold",   PTYPE_FLOAT, 0.0f,   1.0f,  0.5f, NULL,            parse_float,   format_float },  /* -30dB */
+    [PARAM_LOOKAHEAD]    = { "lookahead",    "Lookahead",   PTYPE_FLOAT, 0.0f,   1.0f,  0.0f, NULL,            parse_float,   format_float },  /* 0-10ms */
+    [PARAM_SMOOTHING]    = { "smoothing",    "Smoothing",   PTYPE_FLOAT, 0.0f,   1.0f,  0.0f, NULL,            parse_float,   format_float },  /* 0-10ms */
+    [PARAM_BAND]         = { "band",         "Band",        PTYPE_ENUM,  0.0f,   1.0f,  0.0f, g_band_names,    parse_option,  format_enum },
+    [PARAM_CROSSOVER]    = { "crossover",    "Crossover",   PTYPE_FLOAT, 0.0f,   1.0f,  0.5f, NULL,            parse_float,   format_float },  /* ~126Hz */
+    [PARAM_VOICES]       = { "voices",       "Voices",      PTYPE_ENUM,  0.0f,   2.0f,  0.0f, g_voice_names,   parse_option,  format_enum },
+    [PARAM_CC_OUT]       = { "cc_out",       "CC Out",      PTYPE_ENUM,  0.0f,   2.0f,  0.0f, g_cc_out_names,  parse_option,  format_enum },
+    [PARAM_CC_NUM]       = { "cc_num",       "CC Number",   PTYPE_INT,   0.0f, 119.0f, 20.0f, NULL,            parse_int,     format_int },
+    [PARAM_CC_CHANNEL]   = { "cc_channel",   "CC Channel",  PTYPE_INT,   1.0f,  16.0f,  1.0f, NULL,            parse_int,     format_int },
+    [PARAM_CC_RES]       = { "cc_res",       "CC Res",      PTYPE_ENUM,  0.0f,   1.0f,  0.0f, g_cc_res_names,  parse_option,  format_enum },
+};
+
+static const char *const g_sparam_keys[SPARAM_COUNT] = {
+    [SPARAM_TRIGGER_MAP] = "trigger_map",
+    [SPARAM_MOD_TARGETS] = "mod_targets",
+};
+
+static int sparam_lookup(const char *key) {
+    for (int i = 0; i < SPARAM_COUNT; i++) {
+        if (strcmp(g_sparam_keys[i], key) == 0) return i;
+    }
+    return -1;
+}
+
+/*
+ * Key → PARAM_* lookup: FNV-1a hash into an open-addressed slot table built
+ * once in move_audio_fx_init_v2. A hit costs one hash pass and one strcmp.
+ * Slots hold id + 1 so zero means empty. The table is derived from g_params
+ * at init rather than precomputed, so adding a parameter cannot leave a
+ * stale hand-written hash or switch behind; lookups cost the same.
+ */
+#define PARAM_HASH_SIZE 32
+_Static_assert(PARAM_COUNT < PARAM_HASH_SIZE, "PARAM_HASH_SIZE too small");
+static uint8_t g_param_slots[PARAM_HASH_SIZE];
+
+static uint32_t param_hash(const char *key) {
+    uint32_t h = 2166136261u;
+    while (*key) {
+        h ^= (uint8_t)*key++;
+        h *= 16777619u;
+    }
+    return h;
+}
+
+static void init_param_table(void) {
+    memset(g_param_slots, 0, sizeof(g_param_slots));
+    for (int id = 0; id < PARAM_COUNT; id++) {
+        uint32_t slot = param_hash(g_params[id].key) & (PARAM_HASH_SIZE - 1);
+        while (g_param_slots[slot]) slot = (slot + 1) & (PARAM_HASH_SIZE - 1);
+        g_param_slots[slot] = (uint8_t)(id + 1);
+    }
+}
+
+static int param_lookup(const char *key) {
+    uint32_t slot = param_hash(key) & (PARAM_HASH_SIZE - 1);
+    while (g_param_slots[slot]) {
+        int id = g_param_slots[slot] - 1;
+        if (strcmp(g_params[id].key, key) == 0) return id;
+        slot = (slot + 1) & (PARAM_HASH_SIZE - 1);
+    }
+    return -1;
+}
+
+/* Parameters on the knob page, in knob order */
+static const int g_knob_params[] = {
+    PARAM_CHANNEL, PARAM_TRIGGER_NOTE, PARAM_MODE, PARAM_DEPTH,
+    PARAM_ATTACK, PARAM_HOLD, PARAM_RELEASE, PARAM_CURVE
+};
+
+/*
+ * "chain_params" and "ui_hierarchy" responses, rendered from g_params once
+ * in move_audio_fx_init_v2 so they always agree with the table.
+ */
+#define PARAM_JSON_SIZE 8192
+static char g_chain_params_json[PARAM_JSON_SIZE];
+static char g_ui_hierarchy_json[PARAM_JSON_SIZE];
+
+static int render_chain_param(const param_desc_t *d, char *buf, int buf_len) {
+    int len = snprintf(buf, buf_len, "{\"key\":\"%s\",\"name\":\"%s\",", d->key, d->label);
+    if (len >= buf_len) return len;
+
+    switch (d->type) {
+    case PTYPE_ENUM:
+        len += snprintf(buf + len, buf_len - len, "\"type\":\"enum\",\"options\":[");
+        for (int i = 0; i <= (int)d->max && len < buf_len; i++) {
+            len += snprintf(buf + len, buf_len - len, "%s\"%s\"", i ? "," : "", d->options[i]);
+        }
+        if (len < buf_len) {
+            len += snprintf(buf + len, buf_len - len, "],\"default\":\"%s\"}",
+                            d->options[(int)d->def]);
+        }
+        break;
+    case PTYPE_INT:
+        len += snprintf(buf + len, buf_len - len,
+                        "\"type\":\"int\",\"min\":%d,\"max\":%d,\"default\":%d,\"step\":1}",
+                        (int)d->min, (int)d->max, (int)d->def);
+        break;
+    default:
+        len += snprintf(buf + len, buf_len - len,
+                        "\"type\":\"float\",\"min\":%g,\"max\":%g,\"default\":%g,\"step\":0.01}",
+                        d->min, d->max, d->def);
+        break;
+    }
+    return len;
+}
+
+static void init_param_json(void) {
+    char *buf = g_chain_params_json;
+    int buf_len = (int)sizeof(g_chain_params_json);
+
+    int len = snprintf(buf, buf_len, "[");
+    for (int i = 0; i < PARAM_COUNT && len < buf_len; i++) {
+        if (i > 0) len += snprintf(buf + len, buf_len - len, ",");
+        if (len < buf_len) len += render_chain_param(&g_params[i], buf + len, buf_len - len);
+    }
+    if (len < buf_len) len += snprintf(buf + len, buf_len - len, "]");
+    if (len >= buf_len) ducker_log("chain_params JSON truncated");
+
+    buf = g_ui_hierarchy_json;
+    buf_len = (int)sizeof(g_ui_hierarchy_json);
+    len = snprintf(buf, buf_len,
+                   "{\"modes\":null,\"levels\":{\"root\":{\"children\":null,\"knobs\":[");
+    int knobs = (int)(sizeof(g_knob_params) / sizeof(g_knob_params[0]));
+    for (int i = 0; i < knobs && len < buf_len; i++) {
+        len += snprintf(buf + len, buf_len - len, "%s\"%s\"",
+                        i ? "," : "", g_params[g_knob_params[i]].key);
+    }
+    if (len < buf_len) len += snprintf(buf + len, buf_len - len, "],\"params\":[");
+    for (int i = 0; i < PARAM_COUNT && len < buf_len; i++) {
+        len += snprintf(buf + len, buf_len - len, "%s\"%s\"", i ? "," : "", g_params[i].key);
+    }
+    if (len < buf_len) len += snprintf(buf + len, buf_len - len, "]}}}");
+    if (len >= buf_len) ducker_log("ui_hierarchy JSON truncated");
+}
+
+/* --- Parameter commands (audio thread side) --- */
+
+static void set_lookahead(ducker_instance_t *inst, float value) {
+    int len = ms_to_samples(value * LOOKAHEAD_MAX_MS);
+    /* The delay lines stand still while lookahead is off; clear them so
+     * turning it back on starts from silence, not stale audio */
+    if (inst->lookahead_len == 0 && len > 0) {
+        memset(inst->delay, 0, DELAY_FRAMES * sizeof(uint32_t));
+        memset(inst->delay_f32, 0, DELAY_FRAMES * 2 * sizeof(float));
+    }
+    inst->lookahead_len = len;
+}
+
+static void apply_param(ducker_instance_t *inst, int id, float value) {
+    switch (id) {
+    case PARAM_CHANNEL:
+    case PARAM_TRIGGER_NOTE:
+        /* Resolved through note_map, which the control thread rebuilds */
+        break;
+    case PARAM_MODE:         inst->mode = (int)value; break;
+    case PARAM_DEPTH:        inst->depth = value; break;
+    case PARAM_ATTACK:       inst->attack = value; inst->lengths_dirty = 1; break;
+    case PARAM_HOLD:         inst->hold = value; inst->lengths_dirty = 1; break;
+    case PARAM_RELEASE:      inst->release = value; inst->lengths_dirty = 1; break;
+    case PARAM_CURVE:        inst->curve = (int)value; break;
+    case PARAM_VEL_SENS:     inst->vel_sens = value; break;
+    case PARAM_SYNC:         inst->sync = (int)value; inst->lengths_dirty = 1; break;
+    case PARAM_HOLD_DIV:     inst->hold_div = (int)value; inst->lengths_dirty = 1; break;
+    case PARAM_RELEASE_DIV:  inst->release_div = (int)value; inst->lengths_dirty = 1; break;
+    case PARAM_SEQ:          inst->seq = (int)value; break;
+    case PARAM_SEQ_STEPS:    inst->seq_steps = (int)value; update_seq_mask(inst); break;
+    case PARAM_SEQ_PATTERN:  inst->seq_pattern = (int)value; update_seq_mask(inst); break;
+    case PARAM_KEY_SOURCE:   inst->key_source = (int)value; break;
+    case PARAM_LOOKAHEAD:    set_lookahead(inst, value); break;
+    case PARAM_SMOOTHING:    set_smoothing(inst, value); break;
+    case PARAM_BAND:         set_band(inst, (int)value); break;
+    case PARAM_CROSSOVER:    set_crossover(inst, value); break;
+    case PARAM_VOICES:       set_voice_mode(inst, (int)value); break;
+    case PARAM_CC_OUT:       inst->cc_out = (int)value; reset_cc(inst); break;
+    case PARAM_CC_NUM:       inst->cc_num = (int)value; reset_cc(inst); break;
+    case PARAM_CC_CHANNEL:   inst->cc_channel = (int)value; reset_cc(inst); break;
+    case PARAM_CC_RES:       inst->cc_res = (int)value; reset_cc(inst); break;
+    case PARAM_THRESHOLD:
+        /* 0-1 → -60dB to 0dBFS */
+        inst->threshold = 32767.0f * powf(10.0f, (value * 60.0f - 60.0f) / 20.0f);
+        break;
+    default: break;
+    }
+}
+
+/* Apply every published command; called once at the top of each block */
+static void drain_param_commands(ducker_instance_t *inst) {
+    uint32_t tail = atomic_load_explicit(&inst->cmd_tail, memory_order_relaxed);
+    uint32_t head = atomic_load_explicit(&inst->cmd_head, memory_order_acquire);
+
+    if (tail != head) {
+        while (tail != head) {
+            const param_cmd_t *cmd = &inst->cmd_ring[tail & (PARAM_QUEUE_SIZE - 1)];
+            apply_param(inst, cmd->id, cmd->value);
+            tail++;
+        }
+        atomic_store_explicit(&inst->cmd_tail, tail, memory_order_release);
+    }
+
+    /* An overflow snapshot is newer than anything left in the ring */
+    if (atomic_load_explicit(&inst->snap_mid, memory_order_relaxed) & SNAP_FRESH) {
+        uint32_t old = atomic_exchange_explicit(&inst->snap_mid, (uint32_t)inst->snap_front,
+                                                memory_order_acq_rel);
+        inst->snap_front = (int)(old & 3u);
+        for (int i = 0; i < PARAM_COUNT; i++) {
+            apply_param(inst, i, inst->ctl_snaps[inst->snap_front][i]);
+        }
+    }
+}
+
+/* --- Trigger map (control thread side) --- */
+
+/*
+ * Parse "note:scale" entries (separated by commas or spaces) into notes[]
+ * and scales[]; returns the number kept. Malformed entries are skipped,
+ * scales are clamped to 0-1 and later duplicates win.
+ */
+static int parse_trigger_map(const char *val, int *notes, float *scales) {
+    int n = 0;
+    const char *p = val;
+
+    while (*p) {
+        if (*p == ',' || *p == ' ') {
+            p++;
+            continue;
+        }
+
+        char *q;
+        long note = strtol(p, &q, 10);
+        if (q == p || *q != ':') {
+            while (*p && *p != ',' && *p != ' ') p++;
+            continue;
+        }
+        p = q + 1;
+        float scale = strtof(p, &q);
+        if (q == p || note < 0 || note > 127 || !is_finite_f(scale)) {
+            while (*p && *p != ',' && *p != ' ') p++;
+            continue;
+        }
+        p = q;
+
+        int i = 0;
+        while (i < n && notes[i] != (int)note) i++;
+        if (i == n) {
+            if (n == TRIGGER_MAP_MAX) continue;
+            n++;
+        }
+        notes[i] = (int)note;
+        scales[i] = clampf(scale, 0.0f, 1.0f);
+    }
+    return n;
+}
+
+/* Store the canonical form of a trigger map value */
+static void set_trigger_map(ducker_instance_t *inst, const char *val) {
+    int notes[TRIGGER_MAP_MAX];
+    float scales[TRIGGER_MAP_MAX];
+    int n = parse_trigger_map(val, notes, scales);
+
+    char *out = inst->sparams[SPARAM_TRIGGER_MAP];
+    int len = 0;
+    out[0] = '\0';
+    for (int i = 0; i < n; i++) {
+        len += snprintf(out + len, SPARAM_SIZE - (size_t)len,
+                        "%s%d:%.3f", (i > 0) ? "," : "", notes[i], scales[i]);
+    }
+}
+
+/*
+ * Rebuild note_map from ctl[] and trigger_map. The table is built on the
+ * stack and only changed entries are stored, so notes that stay mapped
+ * never read as 0 mid-update.
+ */
+static void build_note_map(ducker_instance_t *inst) {
+    uint8_t map[16][128];
+    memset(map, 0, sizeof(map));
+
+    int notes[TRIGGER_MAP_MAX + 1];
+    float scales[TRIGGER_MAP_MAX + 1];
+    int n = parse_trigger_map(inst->sparams[SPARAM_TRIGGER_MAP], notes, scales);
+
+    /* The main trigger note always ducks at full depth */
+    notes[n] = (int)inst->ctl[PARAM_TRIGGER_NOTE];
+    scales[n++] = 1.0f;
+
+    int channel = (int)inst->ctl[PARAM_CHANNEL];    /* 0=omni, 1-16 */
+    for (int ch = 0; ch < 16; ch++) {
+        if (channel > 0 && ch != channel - 1) continue;
+        for (int i = 0; i < n; i++) {
+            map[ch][notes[i]] = (uint8_t)lrintf(scales[i] * (float)TRIGGER_SCALE_FULL);
+        }
+    }
+
+    for (int ch = 0; ch < 16; ch++) {
+        for (int note = 0; note < 128; note++) {
+            if (atomic_load_explicit(&inst->note_map[ch][note], memory_order_relaxed) !=
+                map[ch][note]) {
+                atomic_store_explicit(&inst->note_map[ch][note], map[ch][note],
+                                      memory_order_relaxed);
+            }
+        }
+    }
+}
+
+/* --- Modulation output --- */
+
+/* Copy a route name token (letters, digits, '_', '-', '.'); returns its end */
+static const char *read_mod_name(const char *p, char *out) {
+    int i = 0;
+    while ((*p >= 'a' && *p <= 'z') || (*p >= 'A' && *p <= 'Z') || (*p >= '0' && *p <= '9') ||
+           *p == '_' || *p == '-' || *p == '.') {
+        if (i < MOD_NAME_SIZE - 1) out[i++] = *p;
+        p++;
+    }
+    out[i] = '\0';
+    return p;
+}
+
+/*
+ * Parse "target:param:depth" routes (separated by commas or spaces) into
+ * set. Malformed entries are skipped and depth is clamped to -1..1.
+ */
+static void parse_mod_targets(const char *val, mod_route_set_t *set) {
+    const char *p = val;
+    set->count = 0;
+
+    while (*p && set->count < MOD_TARGETS_MAX) {
+        if (*p == ',' || *p == ' ') {
+            p++;
+            continue;
+        }
+
+        mod_route_t *r = &set->routes[set->count];
+        char *q;
+        p = read_mod_name(p, r->target);
+        if (*p == ':') p = read_mod_name(p + 1, r->param);
+        if (*p == ':' && r->target[0] && r->param[0]) {
+            float depth = strtof(p + 1, &q);
+            if (q != p + 1 && is_finite_f(depth)) {
+                r->depth = clampf(depth, -1.0f, 1.0f);
+                set->count++;
+                p = q;
+                continue;
+            }
+        }
+        while (*p && *p != ',' && *p != ' ') p++;
+    }
+}
+
+/*
+ * Store the canonical routes and hand them to the audio thread. Routes that
+ * don't fit whole in SPARAM_SIZE are dropped rather than cut off, so the
+ * stored string always matches the live set and round-trips through state.
+ * An unchanged set is not republished: the audio thread would clear and
+ * re-send every route, briefly zeroing downstream modulation.
+ */
+static void set_mod_targets(ducker_instance_t *inst, const char *val) {
+    mod_route_set_t *set = &inst->mod_sets[inst->mod_back];
+    parse_mod_targets(val, set);
+
+    char out[SPARAM_SIZE];
+    int len = 0;
+    out[0] = '\0';
+    for (int i = 0; i < set->count; i++) {
+        const mod_route_t *r = &set->routes[i];
+        int n = snprintf(out + len, SPARAM_SIZE - (size_t)len, "%s%s:%s:%.3f",
+                         (i > 0) ? "," : "", r->target, r->param, r->depth);
+        if (n >= SPARAM_SIZE - len) {
+            out[len] = '\0';
+            set->count = i;
+            ducker_log("Modulation routes too long, extra routes dropped");
+            break;
+        }
+        len += n;
+    }
+
+    if (strcmp(out, inst->sparams[SPARAM_MOD_TARGETS]) == 0) return;
+    memcpy(inst->sparams[SPARAM_MOD_TARGETS], out, SPARAM_SIZE);
+
+    uint32_t old = atomic_exchange_explicit(&inst->mod_mid,
+                                            (uint32_t)inst->mod_back | MOD_SET_FRESH,
+                                            memory_order_acq_rel);
+    inst->mod_back = (int)(old & 3u);
+}
+
+/*
+ * Emit the gain reduction (0 = no duck, 1 = full) to every route, at most
+ * once per block. Skipped while it is unchanged (so while idle) or has
+ * moved less than MOD_EMIT_THRESHOLD; a return to exactly 0 is always sent.
+ * New routes clear the previous ones and are sent the current value.
+ */
+static void publish_mod(ducker_instance_t *inst) {
+    if (!g_host || !g_host->mod_emit_value) return;
+
+    int force = 0;
+    if (atomic_load_explicit(&inst->mod_mid, memory_order_relaxed) & MOD_SET_FRESH) {
+        uint32_t old = atomic_exchange_explicit(&inst->mod_mid, (uint32_t)inst->mod_front,
+                                                memory_order_acq_rel);
+        inst->mod_front = (int)(old & 3u);
+        if (g_host->mod_clear_source) {
+            g_host->mod_clear_source(g_host->mod_host_ctx, inst->mod_source);
+        }
+        force = 1;
+    }
+
+    const mod_route_set_t *set = &inst->mod_sets[inst->mod_front];
+    if (set->count == 0) return;
+
+    float gr = 1.0f - inst->gain_last;
+    if (!force) {
+        if (gr == inst->mod_sent) return;
+        if (gr != 0.0f && fabsf(gr - inst->mod_sent) < MOD_EMIT_THRESHOLD) return;
+    }
+
+    for (int i = 0; i < set->count; i++) {
+        const mod_route_t *r = &set->routes[i];
+        g_host->mod_emit_value(g_host->mod_host_ctx, inst->mod_source, r->target, r->param,
+                               gr, r->depth, 0.0f, 0, 1);
+    }
+    inst->mod_sent = gr;
+}
+
+/* --- Audio FX API v2 implementation --- */
+
+static void* v2_create_instance(const char *module_dir, const char *config_json) {
+    ducker_log("Creating instance");
+
+    ducker_instance_t *inst = (ducker_instance_t *)calloc(1, sizeof(ducker_instance_t));
+    if (!inst) {
+        ducker_log("Failed to allocate instance");
+        return NULL;
+    }
+
+    if (module_dir) {
+        strncpy(inst->module_dir, module_dir, sizeof(inst->module_dir) - 1);
+    }
+
+    /* Allocated up front so lookahead changes never allocate on the audio thread */
+    inst->delay = (uint32_t *)calloc(DELAY_FRAMES, sizeof(uint32_t));
+    inst->delay_f32 = (float *)calloc(DELAY_FRAMES * 2, sizeof(float));
+    if (!inst->delay || !inst->delay_f32) {
+        ducker_log("Failed to allocate lookahead buffer");
+        free(inst->delay);
+        free(inst->delay_f32);
+        free(inst);
+        return NULL;
+    }
+
+    /* Defaults */
+    for (int i = 0; i < PARAM_COUNT; i++) {
+        inst->ctl[i] = g_params[i].def;
+        apply_param(inst, i, g_params[i].def);
+    }
+    build_note_map(inst);
+    inst->bpm = 120.0f;
+    update_lengths(inst);
+    inst->seq_last_step = -1;
+    inst->det_armed = 1;
+    inst->phase = PHASE_IDLE;
+    inst->envelope = 1.0f;
+    for (int v = 0; v < MAX_VOICES; v++) voice_idle(inst, v);
+    inst->smooth_r = 0.0f;
+    inst->active_notes = 0;
+
+    inst->ctl_gen = 1;
+    inst->state_gen = 0;
+
+    snprintf(inst->mod_source, sizeof(inst->mod_source), "ducker-%p", (void *)inst);
+    inst->mod_front = 0;
+    inst->mod_back = 2;
+    atomic_init(&inst->mod_mid, 1);
+    inst->gain_last = 1.0f;
+    inst->meter_min = 1.0f;
+    atomic_init(&inst->meter_head, 0);
+    atomic_init(&inst->hist_head, 0);
+
+    atomic_init(&inst->cmd_head, 0);
+    atomic_init(&inst->cmd_tail, 0);
+    inst->snap_front = 0;
+    inst->snap_back = 2;
+    atomic_init(&inst->snap_mid, 1);
+
+    ducker_log("Instance created");
+    return inst;
+}
+
+static void v2_destroy_instance(void *instance) {
+    ducker_instance_t *inst = (ducker_instance_t *)instance;
+    if (!inst) return;
+    ducker_log("Destroying instance");
+    if (g_host && g_host->mod_clear_source) {
+        g_host->mod_clear_source(g_host->mod_host_ctx, inst->mod_source);
+    }
+    free(inst->delay);
+    free(inst->delay_f32);
+    free(inst);
+}
+
+/* --- Lookahead delay --- */
+
+static void delay_write(uint32_t *ring, uint32_t pos, const int16_t *src, int n) {
+    uint32_t start = pos & (DELAY_FRAMES - 1);
+    int first = DELAY_FRAMES - (int)start;
+    if (first > n) first = n;
+    memcpy(ring + start, src, (size_t)first * sizeof(uint32_t));
+    memcpy(ring, src + first * 2, (size_t)(n - first) * sizeof(uint32_t));
+}
+
+static void delay_read(const uint32_t *ring, uint32_t pos, int16_t *dst, int n) {
+    uint32_t start = pos & (DELAY_FRAMES - 1);
+    int first = DELAY_FRAMES - (int)start;
+    if (first > n) first = n;
+    memcpy(dst, ring + start, (size_t)first * sizeof(uint32_t));
+    memcpy(dst + first * 2, ring, (size_t)(n - first) * sizeof(uint32_t));
+}
+
+/*
+ * Delay the block by lookahead_len samples in place. The envelope is
+ * rendered on the undelayed timeline, so it leads the audio it scales.
+ */
+static void delay_audio(ducker_instance_t *inst, int16_t *audio, int frames) {
+    while (frames > 0) {
+        int n = (frames < MAX_BLOCK_FRAMES) ? frames : MAX_BLOCK_FRAMES;
+        delay_write(inst->delay, inst->delay_pos, audio, n);
+        delay_read(inst->delay, inst->delay_pos - (uint32_t)inst->lookahead_len, audio, n);
+        inst->delay_pos += (uint32_t)n;
+        audio += n * 2;
+        frames -= n;
+    }
+}
+
+static void delay_write_f32(float *ring, uint32_t pos, const float *src, int n) {
+    uint32_t start = pos & (DELAY_FRAMES - 1);
+    int first = DELAY_FRAMES - (int)start;
+    if (first > n) first = n;
+    memcpy(ring + start, src, (size_t)first * sizeof(float));
+    memcpy(ring, src + first, (size_t)(n - first) * sizeof(float));
+}
+
+static void delay_read_f32(const float *ring, uint32_t pos, float *dst, int n) {
+    uint32_t start = pos & (DELAY_FRAMES - 1);
+    int first = DELAY_FRAMES - (int)start;
+    if (first > n) first = n;
+    memcpy(dst, ring + start, (size_t)first * sizeof(float));
+    memcpy(dst + first, ring, (size_t)(n - first) * sizeof(float));
+}
+
+/* Planar float32 counterpart of delay_audio() */
+static void delay_audio_f32(ducker_instance_t *inst, float *left, float *right, int frames) {
+    float *ring_l = inst->delay_f32;
+    float *ring_r = inst->delay_f32 + DELAY_FRAMES;
+
+    while (frames > 0) {
+        int n = (frames < MAX_BLOCK_FRAMES) ? frames : MAX_BLOCK_FRAMES;
+        uint32_t read_pos = inst->delay_pos - (uint32_t)inst->lookahead_len;
+        delay_write_f32(ring_l, inst->delay_pos, left, n);
+        delay_write_f32(ring_r, inst->delay_pos, right, n);
+        delay_read_f32(ring_l, read_pos, left, n);
+        delay_read_f32(ring_r, read_pos, right, n);
+        inst->delay_pos += (uint32_t)n;
+        left += n;
+        right += n;
+        frames -= n;
+    }
+}
+
+/* --- Gain application --- */
+
+#ifdef DUCKER_NEON
+/* Convert 8 per-frame gains to Q15; 1.0 saturates to 32767 */
+static inline int16x8_t gain_to_q15(const float *gain) {
+    int32x4_t lo = vcvtq_n_s32_f32(vld1q_f32(gain), 15);
+    int32x4_t hi = vcvtq_n_s32_f32(vld1q_f32(gain + 4), 15);
+    return vcombine_s16(vqmovn_s32(lo), vqmovn_s32(hi));
+}
+
+/* Lanes of 8 per-frame gains that are unity (all ones) or not (zero) */
+static inline uint16x8_t gain_unity_mask(const float *gain) {
+    const float32x4_t one = vdupq_n_f32(1.0f);
+    uint32x4_t lo = vcgeq_f32(vld1q_f32(gain), one);
+    uint32x4_t hi = vcgeq_f32(vld1q_f32(gain + 4), one);
+    return vcombine_u16(vmovn_u32(lo), vmovn_u32(hi));
+}
+#endif
+
+/*
+ * Apply a per-frame gain to stereo interleaved int16 audio in place.
+ * NEON path deinterleaves 8 frames per iteration and scales both channels
+ * in Q15 with a saturating rounding multiply, so samples never leave int16;
+ * only the gain is converted, once per frame. The scalar loop is the float
+ * reference (and handles the tail): it truncates where Q15 rounds, and the
+ * two stay within 1 LSB of each other. Unity saturates to 32767 in Q15, so
+ * frames at exactly 1.0 (smoother tails, the idle end of a partly active
+ * run) keep their input samples instead, bit-exact like the idle bypass.
+ */
+static void apply_gain(int16_t *audio, const float *gain, int frames) {
+    int i = 0;
+
+#ifdef DUCKER_NEON
+    for (; i + 8 <= frames; i += 8) {
+        int16x8x2_t lr = vld2q_s16(audio + i * 2);
+        int16x8_t g = gain_to_q15(gain + i);
+        uint16x8_t unity = gain_unity_mask(gain + i);
+        lr.val[0] = vbslq_s16(unity, lr.val[0], vqrdmulhq_s16(lr.val[0], g));
+        lr.val[1] = vbslq_s16(unity, lr.val[1], vqrdmulhq_s16(lr.val[1], g));
+        vst2q_s16(audio + i * 2, lr);
+    }
+#endif
+
+    for (; i < frames; i++) {
+        float l = (float)audio[i * 2] * gain[i];
+        float r = (float)audio[i * 2 + 1] * gain[i];
+
+        /* Clamp to int16 range */
+        if (l > 32767.0f) l = 32767.0f;
+        if (l < -32768.0f) l = -32768.0f;
+        if (r > 32767.0f) r = 32767.0f;
+        if (r < -32768.0f) r = -32768.0f;
+
+        audio[i * 2] = (int16_t)l;
+        audio[i * 2 + 1] = (int16_t)r;
+    }
+}
+
+/* Apply a per-frame gain to planar float32 audio in place; no clamping */
+static void apply_gain_f32(float *left, float *right, const float *gain, int frames) {
+    int i = 0;
+
+#ifdef DUCKER_NEON
+    for (; i + 4 <= frames; i += 4) {
+        float32x4_t g = vld1q_f32(gain + i);
+        vst1q_f32(left + i, vmulq_f32(vld1q_f32(left + i), g));
+        vst1q_f32(right + i, vmulq_f32(vld1q_f32(right + i), g));
+    }
+#endif
+
+    for (; i < frames; i++) {
+        left[i] *= gain[i];
+        right[i] *= gain[i];
+    }
+}
+
+#ifdef DUCKER_NEON
+/* Crossover coefficients and state, held in registers across a run */
+typedef struct xo_regs {
+    float32x4_t b0, b1, b2, a1, a2;
+    float32x4_t z1[2], z2[2];
+} xo_regs_t;
+
+static inline void xo_load(xo_regs_t *r, const ducker_instance_t *inst) {
+    r->b0 = vld1q_f32(inst->xo_b0);
+    r->b1 = vld1q_f32(inst->xo_b1);
+    r->b2 = vld1q_f32(inst->xo_b2);
+    r->a1 = vld1q_f32(inst->xo_a1);
+    r->a2 = vld1q_f32(inst->xo_a2);
+    for (int st = 0; st < 2; st++) {
+        r->z1[st] = vld1q_f32(inst->xo_z1[st]);
+        r->z2[st] = vld1q_f32(inst->xo_z2[st]);
+    }
+}
+
+static inline void xo_save(const xo_regs_t *r, ducker_instance_t *inst) {
+    for (int st = 0; st < 2; st++) {
+        vst1q_f32(inst->xo_z1[st], r->z1[st]);
+        vst1q_f32(inst->xo_z2[st], r->z2[st]);
+    }
+}
+
+/* One LR4 step on {L, R, L, R}; returns {low L, low R, high L, high R} */
+static inline float32x4_t xo_step(xo_regs_t *r, float32x2_t lr) {
+    float32x4_t x = vcombine_f32(lr, lr);
+    for (int st = 0; st < 2; st++) {
+        float32x4_t y = vmlaq_f32(r->z1[st], r->b0, x);
+        r->z1[st] = vmlsq_f32(vmlaq_f32(r->z2[st], r->b1, x), r->a1, y);
+        r->z2[st] = vmlsq_f32(vmulq_f32(r->b2, x), r->a2, y);
+        x = y;
+    }
+    return x;
+}
+
+/* Scale the low band of one split frame and sum it with the high band */
+static inline float32x2_t xo_mix(float32x4_t y, float gain) {
+    return vmla_n_f32(vget_high_f32(y), vget_low_f32(y), gain);
+}
+#else
+/* One LR4 step: x is {L, R, L, R} in, {low L, low R, high L, high R} out */
+static inline void xo_step(ducker_instance_t *inst, float x[4]) {
+    for (int st = 0; st < 2; st++) {
+        float *z1 = inst->xo_z1[st];
+        float *z2 = inst->xo_z2[st];
+        for (int k = 0; k < 4; k++) {
+            float y = inst->xo_b0[k] * x[k] + z1[k];
+            z1[k] = inst->xo_b1[k] * x[k] - inst->xo_a1[k] * y + z2[k];
+            z2[k] = inst->xo_b2[k] * x[k] - inst->xo_a2[k] * y;
+            x[k] = y;
+        }
+    }
+}
+#endif
+
+/*
+ * Split stereo int16 audio with the LR4 crossover, scale only the low band
+ * by the per-frame gain and sum the bands back, in place. At unity gain the
+ * sum is the crossover's allpass response, so this runs every block while
+ * low-band mode is on, ducking or not. NEON keeps all four filter lanes
+ * in one register.
+ */
+static void apply_gain_low(ducker_instance_t *inst, int16_t *audio, const float *gain, int frames) {
+    xo_check_state(inst);
+#ifdef DUCKER_NEON
+    xo_regs_t r;
+    xo_load(&r, inst);
+
+    for (int i = 0; i < frames; i++) {
+        float32x2_t lr = vdup_n_f32((float)audio[i * 2]);
+        lr = vset_lane_f32((float)audio[i * 2 + 1], lr, 1);
+
+        int32x2_t out_i = vcvt_s32_f32(xo_mix(xo_step(&r, lr), gain[i]));
+        int16x4_t out_s = vqmovn_s32(vcombine_s32(out_i, out_i));
+        audio[i * 2] = vget_lane_s16(out_s, 0);
+        audio[i * 2 + 1] = vget_lane_s16(out_s, 1);
+    }
+
+    xo_save(&r, inst);
+#else
+    for (int i = 0; i < frames; i++) {
+        float x[4] = { audio[i * 2], audio[i * 2 + 1], audio[i * 2], audio[i * 2 + 1] };
+        xo_step(inst, x);
+
+        float l = x[2] + x[0] * gain[i];
+        float r = x[3] + x[1] * gain[i];
+
+        /* Clamp to int16 range */
+        if (l > 32767.0f) l = 32767.0f;
+        if (l < -32768.0f) l = -32768.0f;
+        if (r > 32767.0f) r = 32767.0f;
+        if (r < -32768.0f) r = -32768.0f;
+
+        audio[i * 2] = (int16_t)l;
+        audio[i * 2 + 1] = (int16_t)r;
+    }
+#endif
+}
+
+/* Planar float32 counterpart of apply_gain_low(); no clamping */
+static void apply_gain_low_f32(ducker_instance_t *inst, float *left, float *right,
+                               const float *gain, int frames) {
+    xo_check_state(inst);
+#ifdef DUCKER_NEON
+    xo_regs_t r;
+    xo_load(&r, inst);
+
+    for (int i = 0; i < frames; i++) {
+        float32x2_t lr = vset_lane_f32(right[i], vdup_n_f32(left[i]), 1);
+        float32x2_t out = xo_mix(xo_step(&r, lr), gain[i]);
+        left[i] = vget_lane_f32(out, 0);
+        right[i] = vget_lane_f32(out, 1);
+    }
+
+    xo_save(&r, inst);
+#else
+    for (int i = 0; i < frames; i++) {
+        float x[4] = { left[i], right[i], left[i], right[i] };
+        xo_step(inst, x);
+        left[i] = x[2] + x[0] * gain[i];
+        right[i] = x[3] + x[1] * gain[i];
+    }
+#endif
+}
+
+/* --- Envelope rendering --- */
+
+static void fill_gain(float *gain, float value, int n) {
+    for (int i = 0; i < n; i++) gain[i] = value;
+}
+
+/*
+ * Lowest gain in a run, for the telemetry peak. Two independent 4-lane
+ * minimums keep the reduction from serializing on one register.
+ */
+static float gain_min(const float *gain, int n) {
+    int i = 0;
+    float m = 1.0f;
+#ifdef DUCKER_NEON
+    float32x4_t m0 = vdupq_n_f32(1.0f), m1 = m0;
+    for (; i + 8 <= n; i += 8) {
+        m0 = vminq_f32(m0, vld1q_f32(gain + i));
+        m1 = vminq_f32(m1, vld1q_f32(gain + i + 4));
+    }
+    m0 = vminq_f32(m0, m1);
+    float32x2_t p = vpmin_f32(vget_low_f32(m0), vget_high_f32(m0));
+    m = vget_lane_f32(vpmin_f32(p, p), 0);
+#else
+    float lanes[8] = { 1.0f, 1.0f, 1.0f, 1.0f, 1.0f, 1.0f, 1.0f, 1.0f };
+    for (; i + 8 <= n; i += 8) {
+        for (int k = 0; k < 8; k++) lanes[k] = (gain[i + k] < lanes[k]) ? gain[i + k] : lanes[k];
+    }
+    for (int k = 0; k < 8; k++) m = (lanes[k] < m) ? lanes[k] : m;
+#endif
+    for (; i < n; i++) m = (gain[i] < m) ? gain[i] : m;
+    return m;
+}
+
+/*
+ * Render n samples of an attack/release ramp: gain = base + span * shape(t),
+ * with t carried in the instance's phase accumulator going 0→1. For attack,
+ * base=1 and span=-depth (duck DOWN); for release, base=1-depth and
+ * span=depth (recover UP).
+ * Every curve costs the same: one table lookup and interpolation per sample,
+ * and no division.
+ */
+static void render_ramp(ducker_instance_t *inst, float *gain, int n, const float *table,
+                        float base, float span) {
+    uint32_t acc = inst->phase_acc;
+    uint32_t inc = inst->phase_inc;
+    const float frac_scale = 1.0f / (float)(1u << CURVE_FRAC_BITS);
+
+    for (int i = 0; i < n; i++) {
+        uint32_t idx = acc >> CURVE_FRAC_BITS;
+        float frac = (float)(acc & CURVE_FRAC_MASK) * frac_scale;
+        float y = table[idx] + (table[idx + 1] - table[idx]) * frac;
+        gain[i] = base + span * y;
+        acc += inc;
+    }
+
+    inst->phase_acc = acc;
+}
+
+/*
+ * Render one run of the envelope up to the next phase boundary (or the end
+ * of the buffer) and apply the phase transition if the run reaches it.
+ * Returns the number of samples written; always at least 1.
+ */
+static int render_segment(ducker_instance_t *inst, float *gain, int frames) {
+    int n = frames;
+    int remaining = inst->phase_len - inst->phase_pos;
+    if (remaining < 1) remaining = 1;
+
+    switch (inst->phase) {
+    case PHASE_ATTACK:
+        /* Attack ducks down: envelope goes from 1.0 to (1.0 - vel_depth) */
+        if (n > remaining) n = remaining;
+        if (inst->phase_len > 0) {
+            render_ramp(inst, gain, n, curve_table(inst->curve, 0), 1.0f, -inst->vel_depth);
+            inst->envelope = gain[n - 1];
+        } else {
+            fill_gain(gain, inst->envelope, n);
+        }
+        inst->phase_pos += n;
+        if (inst->phase_pos >= inst->phase_len) {
+            start_hold(inst);
+            gain[n - 1] = 1.0f - inst->vel_depth;
+        }
+        break;
+
+    case PHASE_HOLD:
+        /* Stay at ducked level; in gate mode until note-off triggers release */
+        if (inst->mode == MODE_TRIGGER && n > remaining) n = remaining;
+        inst->envelope = 1.0f - inst->vel_depth;
+        fill_gain(gain, inst->envelope, n);
+        inst->phase_pos += n;
+        if (inst->mode == MODE_TRIGGER && inst->phase_pos >= inst->phase_len) {
+            start_release(inst);
+            gain[n - 1] = 1.0f - inst->vel_depth;
+        }
+        break;
+
+    case PHASE_RELEASE:
+        /* Release recovers: envelope goes from (1.0 - vel_depth) to 1.0 */
+        if (n > remaining) n = remaining;
+        if (inst->phase_len > 0) {
+            render_ramp(inst, gain, n, curve_table(inst->curve, 1),
+                        1.0f - inst->vel_depth, inst->vel_depth);
+            inst->envelope = gain[n - 1];
+        } else {
+            fill_gain(gain, inst->envelope, n);
+        }
+        inst->phase_pos += n;
+        if (inst->phase_pos >= inst->phase_len) {
+            inst->phase = PHASE_IDLE;
+            inst->envelope = 1.0f;
+            gain[n - 1] = 1.0f;
+        }
+        break;
+
+    case PHASE_IDLE:
+    default:
+        /* envelope stays at 1.0 (pass-through) */
+        fill_gain(gain, inst->envelope, n);
+        break;
+    }
+
+    return n;
+}
+
+/*
+ * Render n samples of voices [first, first + 4) and fold them into gain:
+ * overwrite if init is set, else min/product with what is there. Lanes are
+ * evaluated together; only the table reads are per lane.
+ */
+static void render_voice_group(ducker_instance_t *inst, float *gain, int n, int first, int init) {
+    voice_pool_t *vp = &inst->voices;
+    const float *tab = g_curve_tables[0];
+    const int use_min = (inst->voice_mode == VOICES_MIN);
+    const float frac_scale = 1.0f / (float)(1u << CURVE_FRAC_BITS);
+
+#ifdef DUCKER_NEON
+    uint32x4_t acc = vld1q_u32(vp->acc + first);
+    const uint32x4_t inc = vld1q_u32(vp->inc + first);
+    const uint32x4_t table = vld1q_u32(vp->table + first);
+    const float32x4_t base = vld1q_f32(vp->base + first);
+    const float32x4_t span = vld1q_f32(vp->span + first);
+    const uint32x4_t frac_mask = vdupq_n_u32(CURVE_FRAC_MASK);
+
+    for (int i = 0; i < n; i++) {
+        uint32x4_t idx = vaddq_u32(table, vshrq_n_u32(acc, CURVE_FRAC_BITS));
+        float32x4_t frac = vmulq_n_f32(vcvtq_f32_u32(vandq_u32(acc, frac_mask)), frac_scale);
+
+        float32x4_t y0 = vdupq_n_f32(0.0f);
+        float32x4_t y1 = vdupq_n_f32(0.0f);
+        y0 = vld1q_lane_f32(tab + vgetq_lane_u32(idx, 0), y0, 0);
+        y1 = vld1q_lane_f32(tab + vgetq_lane_u32(idx, 0) + 1, y1, 0);
+        y0 = vld1q_lane_f32(tab + vgetq_lane_u32(idx, 1), y0, 1);
+        y1 = vld1q_lane_f32(tab + vgetq_lane_u32(idx, 1) + 1, y1, 1);
+        y0 = vld1q_lane_f32(tab + vgetq_lane_u32(idx, 2), y0, 2);
+        y1 = vld1q_lane_f32(tab + vgetq_lane_u32(idx, 2) + 1, y1, 2);
+        y0 = vld1q_lane_f32(tab + vgetq_lane_u32(idx, 3), y0, 3);
+        y1 = vld1q_lane_f32(tab + vgetq_lane_u32(idx, 3) + 1, y1, 3);
+
+        float32x4_t g = vmlaq_f32(base, span, vmlaq_f32(y0, vsubq_f32(y1, y0), frac));
+        float32x2_t h;
+        float value;
+        if (use_min) {
+            h = vpmin_f32(vget_low_f32(g), vget_high_f32(g));
+            value = fminf(vget_lane_f32(h, 0), vget_lane_f32(h, 1));
+            gain[i] = init ? value : fminf(gain[i], value);
+        } else {
+            h = vmul_f32(vget_low_f32(g), vget_high_f32(g));
+            value = vget_lane_f32(h, 0) * vget_lane_f32(h, 1);
+            gain[i] = init ? value : gain[i] * value;
+        }
+        acc = vaddq_u32(acc, inc);
+    }
+
+    vst1q_u32(vp->acc + first, acc);
+#else
+    for (int i = 0; i < n; i++) {
+        float value = 1.0f;
+        for (int v = first; v < first + 4; v++) {
+            uint32_t a = vp->acc[v];
+            const float *t = tab + vp->table[v] + (a >> CURVE_FRAC_BITS);
+            float frac = (float)(a & CURVE_FRAC_MASK) * frac_scale;
+            float g = vp->base[v] + vp->span[v] * (t[0] + (t[1] - t[0]) * frac);
+            value = use_min ? fminf(value, g) : value * g;
+            vp->acc[v] = a + vp->inc[v];
+        }
+        if (init) gain[i] = value;
+        else gain[i] = use_min ? fminf(gain[i], value) : gain[i] * value;
+    }
+#endif
+}
+
+/*
+ * Render up to frames samples of the voice pool into gain, stopping early
+ * once every voice is idle. Rendering runs until the next voice phase
+ * boundary, so each run costs one pass per busy group of 4 voices, and a
+ * block has at most 3 * MAX_VOICES boundaries plus one per trigger.
+ */
+/*
+ * Gain of the frame just rendered by render_voice_group(), with each voice
+ * whose ramp ends there pinned to its exact target (1 - depth for attack,
+ * 1.0 for release) as render_segment() pins the mono envelope. The other
+ * voices are re-evaluated at their last accumulator position.
+ */
+static float voices_last_gain(const ducker_instance_t *inst, uint32_t ending) {
+    const voice_pool_t *vp = &inst->voices;
+    const float frac_scale = 1.0f / (float)(1u << CURVE_FRAC_BITS);
+    const int use_min = (inst->voice_mode == VOICES_MIN);
+    float value = 1.0f;
+
+    for (int v = 0; v < MAX_VOICES; v++) {
+        if (!(vp->mask & (1u << v))) continue;
+        float g;
+        if (ending & (1u << v)) {
+            g = (vp->phase[v] == PHASE_ATTACK) ? 1.0f - vp->depth[v] : 1.0f;
+        } else {
+            uint32_t a = vp->acc[v] - vp->inc[v];
+            const float *t = g_curve_tables[0] + vp->table[v] + (a >> CURVE_FRAC_BITS);
+            float frac = (float)(a & CURVE_FRAC_MASK) * frac_scale;
+            g = vp->base[v] + vp->span[v] * (t[0] + (t[1] - t[0]) * frac);
+        }
+        value = use_min ? fminf(value, g) : value * g;
+    }
+    return value;
+}
+
+static int render_voices(ducker_instance_t *inst, float *gain, int frames) {
+    voice_pool_t *vp = &inst->voices;
+    int i = 0;
+
+    while (i < frames && vp->mask) {
+        int n = frames - i;
+        for (int v = 0; v < MAX_VOICES; v++) {
+            if (!(vp->mask & (1u << v))) continue;
+            if (vp->phase[v] == PHASE_HOLD && inst->mode == MODE_GATE) continue;
+            int remaining = vp->len[v] - vp->pos[v];
+            if (remaining < 1) remaining = 1;
+            if (n > remaining) n = remaining;
+        }
+
+        int init = 1;
+        for (int first = 0; first < MAX_VOICES; first += 4) {
+            if (!(vp->mask & (0xFu << first))) continue;
+            render_voice_group(inst, gain + i, n, first, init);
+            init = 0;
+        }
+
+        /* Ramps ending on this run's last frame land exactly on target */
+        uint32_t ending = 0;
+        for (int v = 0; v < MAX_VOICES; v++) {
+            if (!(vp->mask & (1u << v))) continue;
+            if ((vp->phase[v] == PHASE_ATTACK || vp->phase[v] == PHASE_RELEASE) &&
+                vp->pos[v] + n >= vp->len[v]) {
+                ending |= 1u << v;
+            }
+        }
+        if (ending) gain[i + n - 1] = voices_last_gain(inst, ending);
+
+        for (int v = 0; v < MAX_VOICES; v++) {
+            if (!(vp->mask & (1u << v))) continue;
+            vp->pos[v] += n;
+            if (vp->pos[v] < vp->len[v]) continue;
+            switch (vp->phase[v]) {
+            case PHASE_ATTACK:  voice_hold(inst, v); break;
+            case PHASE_HOLD:    if (inst->mode == MODE_TRIGGER) voice_release(inst, v); break;
+            case PHASE_RELEASE: voice_idle(inst, v); break;
+            default: break;
+            }
+        }
+
+        i += n;
+    }
+    return i;
+}
+
+/*
+ * Render up to frames samples of envelope into gain, stopping early once the
+ * envelope returns to idle. Returns the number of samples rendered; the rest
+ * of the buffer is unity gain and left unwritten.
+ */
+static int render_envelope(ducker_instance_t *inst, float *gain, int frames) {
+    if (inst->voice_mode != VOICES_MONO) return render_voices(inst, gain, frames);
+
+    int i = 0;
+    while (i < frames && inst->phase != PHASE_IDLE) {
+        i += render_segment(inst, gain + i, frames - i);
+    }
+    return i;
+}
+
+/*
+ * Render the gain for the next n frames (n <= MAX_BLOCK_FRAMES) into
+ * inst->gain. Returns how many frames need the gain applied, or -1 when the
+ * envelope is idle and the rest of the run is exactly unity.
+ */
+static int render_gain(ducker_instance_t *inst, int n) {
+    const int crossover = (inst->band == BAND_LOW);
+
+    /* Idle with a settled smoother is exactly unity gain (the crossover
+     * must keep running) */
+    if (!crossover && envelope_idle(inst) && inst->smooth_r == 0.0f) {
+        inst->gain_last = 1.0f;
+        return -1;
+    }
+
+    int active = render_envelope(inst, inst->gain, n);
+    const int smoothing = (inst->smooth_coef > 0.0f);
+
+    if (smoothing || crossover) {
+        /* Both keep running at unity after the envelope idles */
+        fill_gain(inst->gain + active, 1.0f, n - active);
+        active = n;
+    }
+
+    if (smoothing) {
+        smooth_gain(inst, inst->gain, n);
+        if (envelope_idle(inst) && inst->smooth_r < SMOOTHING_SETTLE) {
+            inst->smooth_r = 0.0f;
+        }
+    } else if (!crossover && inst->voice_mode == VOICES_MONO && inst->vel_depth == 0.0f) {
+        /* Zero trigger depth renders exactly 1.0 in every phase */
+        inst->gain_last = 1.0f;
+        return 0;
+    }
+
+    float lowest = gain_min(inst->gain, active);
+    if (lowest < inst->meter_min) inst->meter_min = lowest;
+
+    inst->gain_last = (active == n) ? inst->gain[n - 1] : 1.0f;
+    return active;
+}
+
+/*
+ * Render and apply the envelope over a run of frames with no pending events.
+ */
+static void process_run(ducker_instance_t *inst, int16_t *audio, int frames) {
+    while (frames > 0) {
+        int n = (frames < MAX_BLOCK_FRAMES) ? frames : MAX_BLOCK_FRAMES;
+        int active = render_gain(inst, n);
+        if (active < 0) return;
+
+        if (inst->band == BAND_LOW) {
+            apply_gain_low(inst, audio, inst->gain, n);
+        } else {
+            apply_gain(audio, inst->gain, active);
+        }
+
+        audio += n * 2;
+        frames -= n;
+    }
+}
+
+/* Planar float32 counterpart of process_run() */
+static void process_run_f32(ducker_instance_t *inst, float *left, float *right, int frames) {
+    while (frames > 0) {
+        int n = (frames < MAX_BLOCK_FRAMES) ? frames : MAX_BLOCK_FRAMES;
+        int active = render_gain(inst, n);
+        if (active < 0) return;
+
+        if (inst->band == BAND_LOW) {
+            apply_gain_low_f32(inst, left, right, inst->gain, n);
+        } else {
+            apply_gain_f32(left, right, inst->gain, active);
+        }
+
+        left += n;
+        right += n;
+        frames -= n;
+    }
+}
+
+/*
+ * Per-block control work shared by both process entry points: parameter
+ * changes, tempo, and the sequencer/detector trigger sources.
+ */
+static void begin_block(ducker_instance_t *inst, int frames) {
+    drain_param_commands(inst);
+
+    /*
+     * Sequencer steps only while the host transport runs. A stopped or
+     * unavailable status pauses it for the block without touching
+     * seq_running, so a brief dropout does not need a fresh Start. Hosts
+     * without a clock status are followed by Start/Stop alone.
+     */
+    int seq_active = inst->seq && inst->seq_running;
+    if (g_host && g_host->get_clock_status) {
+        inst->clock_running = (g_host->get_clock_status() == MOVE_CLOCK_STATUS_RUNNING);
+        seq_active &= inst->clock_running;
+    }
+
+    /* Tempo is read at most once per block, and only when needed */
+    if ((inst->sync || seq_active) && g_host && g_host->get_bpm) {
+        float bpm = g_host->get_bpm();
+        if (bpm >= 20.0f && bpm <= 999.0f && bpm != inst->bpm) {
+            inst->bpm = bpm;
+            inst->lengths_dirty = 1;
+        }
+    }
+    if (inst->lengths_dirty) update_lengths(inst);
+
+    if (seq_active) run_sequencer(inst, frames);
+    if (inst->key_source == KEY_AUDIO) run_detector(inst, frames);
+}
+
+/* Rebase events scheduled beyond this block and publish block-rate outputs */
+static void end_block(ducker_instance_t *inst, int frames) {
+    for (int i = 0; i < inst->num_events; i++) {
+        inst->events[i].frame -= frames;
+    }
+
+    publish_mod(inst);
+    publish_cc(inst);
+    publish_meter(inst);
+}
+
+static void v2_process_block(void *instance, int16_t *audio_inout, int frames) {
+    ducker_instance_t *inst = (ducker_instance_t *)instance;
+    if (!inst) return;
+
+    PERF_BEGIN(t0);
+    begin_block(inst, frames);
+
+    if (inst->lookahead_len > 0) delay_audio(inst, audio_inout, frames);
+
+    /* Split the block at each queued event so triggers are sample-accurate */
+    int pos = 0;
+    while (pos < frames) {
+        apply_due_events(inst, pos);
+
+        int end = frames;
+        if (inst->num_events > 0 && inst->events[0].frame < end) {
+            end = inst->events[0].frame;
+        }
+
+        process_run(inst, audio_inout + pos * 2, end - pos);
+        pos = end;
+    }
+
+    end_block(inst, frames);
+    PERF_END(inst->perf_process, t0);
+}
+
+static void process_block_f32(void *instance, float *left, float *right, int frames) {
+    ducker_instance_t *inst = (ducker_instance_t *)instance;
+    if (!inst) return;
+
+    PERF_BEGIN(t0);
+    begin_block(inst, frames);
+
+    if (inst->lookahead_len > 0) delay_audio_f32(inst, left, right, frames);
+
+    /* Split the block at each queued event so triggers are sample-accurate */
+    int pos = 0;
+    while (pos < frames) {
+        apply_due_events(inst, pos);
+
+        int end = frames;
+        if (inst->num_events > 0 && inst->events[0].frame < end) {
+            end = inst->events[0].frame;
+        }
+
+        process_run_f32(inst, left + pos, right + pos, end - pos);
+        pos = end;
+    }
+
+    end_block(inst, frames);
+    PERF_END(inst->perf_process, t0);
+}
+
+/* --- MIDI handler (exported via dlsym for chain host) --- */
+
+/* Note on/off and realtime handling; ducker_on_midi() checks inst and len */
+static inline void handle_midi(ducker_instance_t *inst, const uint8_t *msg, int len, int source,
+                               int frame_offset) {
+    /* Anything but note on/off (0x80-0x9F) is rejected by one compare */
+    if ((uint8_t)(msg[0] - 0x80) >= 0x20) {
+        /* Realtime clock/transport from the host drives the step sequencer */
+        if (msg[0] >= 0xF8 && source == MOVE_MIDI_SOURCE_HOST) seq_on_realtime(inst, msg[0]);
+        return;
+    }
+    if (len < 3) return;
+
+    /* Channel filter and note filter in one load: 0 = not a trigger */
+    uint8_t scale = atomic_load_explicit(&inst->note_map[msg[0] & 0x0F][msg[1] & 0x7F],
+                                         memory_order_relaxed);
+    if (!scale) return;
+
+    uint8_t vel = msg[2];
+    if ((msg[0] & 0x10) && vel > 0) {
+        queue_event(inst, frame_offset, 1, vel, scale);
+    } else {
+        queue_event(inst, frame_offset, 0, 0, 0);
+    }
+}
+
+static void ducker_on_midi(void *instance, const uint8_t *msg, int len, int source,
+                           int frame_offset) {
+    ducker_instance_t *inst = (ducker_instance_t *)instance;
+    if (!inst || len < 1) return;
+
+    PERF_BEGIN(t0);
+    handle_midi(inst, msg, len, source, frame_offset);
+    PERF_END(inst->perf_midi, t0);
+}
+
+/* --- State JSON parser (single pass, bounded, no allocations) --- */
+
+#define JSON_TOKEN_MAX 32
+
+static const char *json_skip_ws(const char *p, const char *end) {
+    while (p < end && (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r')) p++;
+    return p;
+}
+
+/*
+ * Read a string starting at the opening quote into out (truncated to
+ * cap - 1; *overflow is set if so). Escapes are kept verbatim.
+ * Returns the position after the closing quote, or NULL if unterminated.
+ */
+static const char *json_read_string(const char *p, const char *end, char *out, int cap,
+                                    int *overflow) {
+    int i = 0;
+    *overflow = 0;
+    p++;
+    while (p < end && *p != '"') {
+        if (*p == '\\' && p + 1 < end) {
+            if (i < cap - 1) out[i++] = *p; else *overflow = 1;
+            p++;
+        }
+        if (i < cap - 1) out[i++] = *p; else *overflow = 1;
+        p++;
+    }
+    out[i] = '\0';
+    return (p < end) ? p + 1 : NULL;
+}
+
+/* Skip a nested object or array starting at its opening bracket */
+static const char *json_skip_nested(const char *p, const char *end) {
+    int depth = 0;
+    while (p < end) {
+        char c = *p;
+        if (c == '"') {
+            p++;
+            while (p < end && *p != '"') {
+                if (*p == '\\') p++;
+                p++;
+            }
+        } else if (c == '{' || c == '[') {
+            depth++;
+        } else if (c == '}' || c == ']') {
+            if (--depth == 0) return p + 1;
+        }
+        p++;
+    }
+    return NULL;
+}
+
+/*
+ * Parse a flat JSON state object into commands; returns the number written.
+ * One left-to-right pass: keys are only recognised in key position, so a
+ * key name inside a string value never matches. Input longer than
+ * STATE_JSON_MAX is rejected, which bounds the worst case to one scan of
+ * STATE_JSON_MAX bytes plus one hash lookup per key. Later duplicates win;
+ * on malformed input, values parsed before the error are kept.
+ * String parameter values are copied to strs[SPARAM_*] and flagged in
+ * str_present.
+ */
+static int parse_state(const char *json, param_cmd_t *cmds, char strs[][SPARAM_SIZE],
+                       uint8_t *str_present) {
+    float values[PARAM_COUNT];
+    uint8_t present[PARAM_COUNT];
+    memset(present, 0, sizeof(present));
+
+    int len = 0;
+    while (len < STATE_JSON_MAX && json[len]) len++;
+    if (json[len]) {
+        ducker_log("State JSON too long, ignored");
+        return 0;
+    }
+
+    const char *p = json;
+    const char *end = json + len;
+
+    p = json_skip_ws(p, end);
+    if (p >= end || *p != '{') return 0;
+    p++;
+
+    while (p) {
+        char key[JSON_TOKEN_MAX];
+        char tok[JSON_TOKEN_MAX];
+        int key_overflow, tok_overflow = 0, is_string = 0;
+
+        p = json_skip_ws(p, end);
+        if (p >= end || *p == '}') break;
+        if (*p == ',') {
+            p++;
+            continue;
+        }
+        if (*p != '"') break;
+
+        p = json_read_string(p, end, key, JSON_TOKEN_MAX, &key_overflow);
+        if (!p) break;
+        p = json_skip_ws(p, end);
+        if (p >= end || *p != ':') break;
+        p = json_skip_ws(p + 1, end);
+        if (p >= end) break;
+
+        int sid = (*p == '"' && !key_overflow) ? sparam_lookup(key) : -1;
+        if (sid >= 0) {
+            p = json_read_string(p, end, strs[sid], SPARAM_SIZE, &tok_overflow);
+            if (!p) break;
+            if (!tok_overflow) str_present[sid] = 1;
+            continue;
+        } else if (*p == '"') {
+            p = json_read_string(p, end, tok, JSON_TOKEN_MAX, &tok_overflow);
+            if (!p) break;
+            is_string = 1;
+        } else if (*p == '{' || *p == '[') {
+            p = json_skip_nested(p, end);
+            continue;
+        } else {
+            int i = 0;
+            while (p < end && *p != ',' && *p != '}' && *p != ' ' && *p != '\t' &&
+                   *p != '\n' && *p != '\r') {
+                if (i < JSON_TOKEN_MAX - 1) tok[i++] = *p; else tok_overflow = 1;
+                p++;
+            }
+            tok[i] = '\0';
+        }
+        if (key_overflow || tok_overflow) continue;
+
+        int id = param_lookup(key);
+        if (id < 0) continue;
+        const param_desc_t *d = &g_params[id];
+
+        if (is_string) {
+            if (!d->parse(d, tok, &values[id])) continue;
+        } else {
+            char *num_end;
+            float fval = strtof(tok, &num_end);
+            if (num_end == tok || !is_finite_f(fval)) continue;
+            fval = clampf(fval, d->min, d->max);
+            if (d->type != PTYPE_FLOAT) fval = (float)(int)fval;
+            values[id] = fval;
+        }
+        present[id] = 1;
+    }
+
+    int n = 0;
+    for (int id = 0; id < PARAM_COUNT; id++) {
+        if (!present[id]) continue;
+        cmds[n].id = id;
+        cmds[n++].value = values[id];
+    }
+    return n;
+}
+
+/* Hand the audio thread a full copy of ctl[], replacing any it has not taken */
+static void publish_snapshot(ducker_instance_t *inst) {
+    memcpy(inst->ctl_snaps[inst->snap_back], inst->ctl, sizeof(inst->ctl));
+    uint32_t old = atomic_exchange_explicit(&inst->snap_mid,
+                                            (uint32_t)inst->snap_back | SNAP_FRESH,
+                                            memory_order_acq_rel);
+    inst->snap_back = (int)(old & 3u);
+}
+
+/*
+ * Publish a batch of commands to the audio thread. The batch becomes
+ * visible with a single release store, so a block sees all of it or none.
+ * Never waits: if the ring is full, ctl[] goes over as a snapshot instead,
+ * and later changes keep refreshing that snapshot until the audio thread
+ * has taken it, so nothing queued behind it can be applied out of order.
+ */
+static void push_param_commands(ducker_instance_t *inst, const param_cmd_t *cmds, int n) {
+    if (inst->cmd_resync) {
+        if (atomic_load_explicit(&inst->snap_mid, memory_order_acquire) & SNAP_FRESH) {
+            publish_snapshot(inst);
+            return;
+        }
+        inst->cmd_resync = 0;
+    }
+
+    uint32_t head = atomic_load_explicit(&inst->cmd_head, memory_order_relaxed);
+    uint32_t tail = atomic_load_explicit(&inst->cmd_tail, memory_order_acquire);
+    if ((uint32_t)n > PARAM_QUEUE_SIZE - (head - tail)) {
+        ducker_log("Parameter queue full, sending a snapshot");
+        inst->cmd_resync = 1;
+        publish_snapshot(inst);
+        return;
+    }
+
+    for (int i = 0; i < n; i++) {
+        inst->cmd_ring[(head + (uint32_t)i) & (PARAM_QUEUE_SIZE - 1)] = cmds[i];
+    }
+    atomic_store_explicit(&inst->cmd_head, head + (uint32_t)n, memory_order_release);
+}
+
+/*
+ * Apply a string parameter on the control thread. Returns 1 if the trigger
+ * map needs rebuilding.
+ */
+static int set_sparam(ducker_instance_t *inst, int sid, const char *val) {
+    char before[SPARAM_SIZE];
+    memcpy(before, inst->sparams[sid], SPARAM_SIZE);
+
+    switch (sid) {
+    case SPARAM_TRIGGER_MAP: set_trigger_map(inst, val); break;
+    case SPARAM_MOD_TARGETS: set_mod_targets(inst, val); break;
+    default: return 0;
+    }
+
+    if (strcmp(before, inst->sparams[sid]) == 0) return 0;
+    inst->ctl_gen++;
+    return sid == SPARAM_TRIGGER_MAP;
+}
+
+static void v2_set_param(void *instance, const char *key, const char *val) {
+    ducker_instance_t *inst = (ducker_instance_t *)instance;
+    if (!inst || !key || !val) return;
+
+    param_cmd_t cmds[PARAM_COUNT];
+    int n = 0;
+    int remap = 0;
+    int sid;
+
+    if (strcmp(key, "state") == 0) {
+        /* Restore all parameters from JSON state */
+        char strs[SPARAM_COUNT][SPARAM_SIZE];
+        uint8_t str_present[SPARAM_COUNT] = { 0 };
+        n = parse_state(val, cmds, strs, str_present);
+        for (int i = 0; i < SPARAM_COUNT; i++) {
+            if (str_present[i]) remap |= set_sparam(inst, i, strs[i]);
+        }
+    } else if ((sid = sparam_lookup(key)) >= 0) {
+        remap = set_sparam(inst, sid, val);
+    } else {
+        int id = param_lookup(key);
+        if (id < 0) return;
+        cmds[0].id = id;
+        if (!g_params[id].parse(&g_params[id], val, &cmds[0].value)) return;
+        n = 1;
+    }
+
+    for (int i = 0; i < n; i++) {
+        if (inst->ctl[cmds[i].id] != cmds[i].value) {
+            inst->ctl[cmds[i].id] = cmds[i].value;
+            inst->ctl_gen++;
+            if (cmds[i].id == PARAM_CHANNEL || cmds[i].id == PARAM_TRIGGER_NOTE) remap = 1;
+        }
+    }
+    if (remap) build_note_map(inst);
+    if (n > 0) push_param_commands(inst, cmds, n);
+}
+
+/* Regenerate the cached "state" JSON: enums and ints as integers, floats
+ * with 3 decimals, then the string parameters */
+static void render_state(ducker_instance_t *inst) {
+    char *buf = inst->state_json;
+    int buf_len = (int)sizeof(inst->state_json);
+
+    int len = snprintf(buf, buf_len, "{");
+    for (int i = 0; i < PARAM_COUNT && len < buf_len; i++) {
+        const char *sep = (i > 0) ? "," : "";
+        if (g_params[i].type == PTYPE_FLOAT) {
+            len += snprintf(buf + len, buf_len - len, "%s\"%s\":%.3f",
+                            sep, g_params[i].key, inst->ctl[i]);
+        } else {
+            len += snprintf(buf + len, buf_len - len, "%s\"%s\":%d",
+                            sep, g_params[i].key, (int)inst->ctl[i]);
+        }
+    }
+    for (int i = 0; i < SPARAM_COUNT && len < buf_len; i++) {
+        len += snprintf(buf + len, buf_len - len, ",\"%s\":\"%s\"",
+                        g_sparam_keys[i], inst->sparams[i]);
+    }
+    if (len < buf_len) len += snprintf(buf + len, buf_len - len, "}");
+    if (len >= buf_len) {
+        ducker_log("State JSON truncated");
+        len = buf_len - 1;
+    }
+
+    inst->state_len = len;
+    inst->state_gen = inst->ctl_gen;
+}
+
+static int v2_get_param(void *instance, const char *key, char *buf, int buf_len) {
+    ducker_instance_t *inst = (ducker_instance_t *)instance;
+    if (!inst) return -1;
+
+    int id = param_lookup(key);
+    if (id >= 0) return g_params[id].format(&g_params[id], inst->ctl[id], buf, buf_len);
+
+    if (strcmp(key, "latency_samples") == 0) {
+        /* Same conversion the audio thread applies for PARAM_LOOKAHEAD */
+        return snprintf(buf, buf_len, "%d",
+                        ms_to_samples(inst->ctl[PARAM_LOOKAHEAD] * LOOKAHEAD_MAX_MS));
+    }
+    if (strcmp(key, "name") == 0) return snprintf(buf, buf_len, "DUCKER");
+    int sid = sparam_lookup(key);
+    if (sid >= 0) return snprintf(buf, buf_len, "%s", inst->sparams[sid]);
+
+    if (strcmp(key, "state") == 0) {
+        if (inst->state_gen != inst->ctl_gen) render_state(inst);
+        if (inst->state_len >= buf_len) return -1;
+        memcpy(buf, inst->state_json, (size_t)inst->state_len + 1);
+        return inst->state_len;
+    }
+
+    if (strcmp(key, "meter") == 0) return format_meter(inst, buf, buf_len);
+    if (strcmp(key, "gr_history") == 0) return format_gr_history(inst, buf, buf_len);
+#ifdef DUCKER_PERF
+    if (strcmp(key, "perf_stats") == 0) return format_perf_stats(inst, buf, buf_len);
+#endif
+
+    const char *json = NULL;
+    if (strcmp(key, "ui_hierarchy") == 0) json = g_ui_hierarchy_json;
+    else if (strcmp(key, "chain_params") == 0) json = g_chain_params_json;
+    if (json) {
+        int len = (int)strlen(json);
+        if (len >= buf_len) return -1;
+        memcpy(buf, json, (size_t)len + 1);
+        return len;
+    }
+
+    return -1;
+}
+
+/* --- API exports --- */
+
+static audio_fx_api_v2_t g_fx_api_v2;
+
+audio_fx_api_v2_t* move_audio_fx_init_v2(const host_api_v1_t *host) {
+    g_host = host;
+
+    init_curve_tables();
+    init_param_table();
+    init_param_json();
+
+    memset(&g_fx_api_v2, 0, sizeof(g_fx_api_v2));
+    g_fx_api_v2.api_version = AUDIO_FX_API_VERSION_2;
+    g_fx_api_v2.create_instance = v2_create_instance;
+    g_fx_api_v2.destroy_instance = v2_destroy_instance;
     g_fx_api_v2.process_block = v2_process_block;
     g_fx_api_v2.set_param = v2_set_param;
     g_fx_api_v2.get_param = v2_get_param;
@@ -551,5 +3200,25 @@ audio_fx_api_v2_t* move_audio_fx_init_v2(const host_api_v1_t *host) {
  * This avoids ABI issues with old plugins that have a 6-field struct.
  */
 void move_audio_fx_on_midi(void *instance, const uint8_t *msg, int len, int source) {
-    ducker_on_midi(instance, msg, len, source);
+    /* No timestamp: the event lands on the first frame of the next block */
+    ducker_on_midi(instance, msg, len, source, 0);
+}
+
+/*
+ * Timestamped MIDI handler export, also discovered via dlsym.
+ * frame_offset is the sample position of the message within the next
+ * process_block call; offsets beyond that block carry over to later blocks.
+ */
+void move_audio_fx_on_midi_at(void *instance, const uint8_t *msg, int len, int source,
+                              int frame_offset) {
+    ducker_on_midi(instance, msg, len, source, frame_offset);
+}
+
+/*
+ * Planar float32 process export, also discovered via dlsym. Processes
+ * non-interleaved left/right buffers in place with no int16 conversion or
+ * clamping; use instead of process_block, not alongside it.
+ */
+void move_audio_fx_process_f32(void *instance, float *left, float *right, int frames) {
+    process_block_f32(instance, left, right, frames);
 }
@@ -0,0 +1,282 @@
+/*
+ * Envelope end-level test
+ *
+ * Loads ducker.so and renders single triggers through the float32 export with
+ * a DC input of 1.0, so every output sample is the envelope gain itself. Each
+ * run is compared against the original per-sample envelope (t = pos / len
+ * through shape_curve) for every attack and release setting from 0 to 1 in
+ * knob steps: the last attack sample must land exactly on 1 - depth, the
+ * last release sample exactly on 1.0, and every sample in between must stay
+ * within ENVELOPE_TOLERANCE of the reference curve. The sweep runs once in
+ * mono mode and once per voice pool mode, where a lone trigger must render
+ * the same envelope.
+ *
+ * Usage: test_envelope [path/to/ducker.so]
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <math.h>
+#include <dlfcn.h>
+#include "audio_fx_api_v2.h"
+
+#define TEST_FRAMES MOVE_FRAMES_PER_BLOCK
+#define SAMPLE_RATE 44100
+#define KNOB_STEPS 100
+
+/*
+ * Two int16 LSBs. The phase step is 2^32 / len truncated, so t lags by at
+ * most len / 2^32; times the steepest curve slope (3, Pump release) that is
+ * ~3.1e-5 at the 1s maximum, just over one LSB.
+ */
+#define ENVELOPE_TOLERANCE (2.0f / 32768.0f)
+
+typedef void (*on_midi_fn)(void *instance, const uint8_t *msg, int len, int source);
+typedef void (*process_f32_fn)(void *instance, float *left, float *right, int frames);
+
+enum { CURVE_LINEAR = 0, CURVE_EXPO, CURVE_SCURVE, CURVE_PUMP };
+
+static const char *g_curves[] = { "Linear", "Expo", "S-Curve", "Pump" };
+static const char *g_voices[] = { "Mono", "Min", "Product" };
+static const float g_depths[] = { 1.0f, 0.37f };
+
+static audio_fx_api_v2_t *g_api;
+static on_midi_fn g_on_midi;
+static process_f32_fn g_process_f32;
+static const char *g_voice_mode = "Mono";
+
+static void stub_log(const char *msg) {
+    (void)msg;
+}
+
+/* --- Reference envelope (the original per-sample division form) --- */
+
+static int ms_to_samples(float ms) {
+    return (int)(ms * (SAMPLE_RATE / 1000.0f));
+}
+
+/*
+ * Phase length for a knob value. -Ofast may fold knob * max_ms * 44.1 into
+ * knob * (max_ms * 44.1), which can move a boundary by one sample, so the
+ * folded order is available as an alternative; volatile keeps this file's
+ * own compiler from choosing for us.
+ */
+static int knob_samples(float knob, float max_ms, int folded) {
+    volatile float ms = knob * max_ms;
+    volatile float scale = max_ms * (SAMPLE_RATE / 1000.0f);
+    return folded ? (int)(knob * scale) : ms_to_samples(ms);
+}
+
+static float shape_curve(int curve, float t, int is_release) {
+    if (t < 0.0f) t = 0.0f;
+    if (t > 1.0f) t = 1.0f;
+
+    switch (curve) {
+    case CURVE_EXPO:
+        return t * t;
+    case CURVE_SCURVE:
+        return t * t * (3.0f - 2.0f * t);
+    case CURVE_PUMP:
+        if (is_release) {
+            float inv = 1.0f - t;
+            return 1.0f - inv * inv * inv;
+        }
+        return t;
+    case CURVE_LINEAR:
+    default:
+        return t;
+    }
+}
+
+/* Trigger-mode envelope from a note-on at frame 0: attack, hold, release,
+ * then unity */
+static void reference_envelope(float *out, int n, int curve, float depth,
+                               int attack_len, int hold_len, int release_len) {
+    int i = 0;
+    for (int p = 0; p < attack_len && i < n; p++, i++) {
+        out[i] = (p == attack_len - 1)
+            ? 1.0f - depth
+            : 1.0f - depth * shape_curve(curve, (float)p / (float)attack_len, 0);
+    }
+    for (int p = 0; p < hold_len && i < n; p++, i++) out[i] = 1.0f - depth;
+    for (int p = 0; p < release_len && i < n; p++, i++) {
+        out[i] = (p == release_len - 1)
+            ? 1.0f
+            : (1.0f - depth) + depth * shape_curve(curve, (float)p / (float)release_len, 1);
+    }
+    for (; i < n; i++) out[i] = 1.0f;
+}
+
+/* --- Plugin run --- */
+
+static void render_plugin(float *out, int n, const char *curve, float depth,
+                          float attack, float hold, float release) {
+    char buf[32];
+    void *inst = g_api->create_instance(".", NULL);
+
+    g_api->set_param(inst, "voices", g_voice_mode);
+    g_api->set_param(inst, "curve", curve);
+    snprintf(buf, sizeof(buf), "%.2f", depth);
+    g_api->set_param(inst, "depth", buf);
+    snprintf(buf, sizeof(buf), "%.2f", attack);
+    g_api->set_param(inst, "attack", buf);
+    snprintf(buf, sizeof(buf), "%.2f", hold);
+    g_api->set_param(inst, "hold", buf);
+    snprintf(buf, sizeof(buf), "%.2f", release);
+    g_api->set_param(inst, "release", buf);
+
+    uint8_t on[3] = { 0x90, 36, 127 };
+    g_on_midi(inst, on, 3, MOVE_MIDI_SOURCE_INTERNAL);
+
+    float right[TEST_FRAMES];
+    for (int pos = 0; pos < n; pos += TEST_FRAMES) {
+        for (int i = 0; i < TEST_FRAMES; i++) {
+            out[pos + i] = 1.0f;
+            right[i] = 1.0f;
+        }
+        g_process_f32(inst, out + pos, right, TEST_FRAMES);
+    }
+
+    g_api->destroy_instance(inst);
+}
+
+/*
+ * Compare one rendered setting against the reference with the given phase
+ * lengths. Returns a description of the first mismatch or NULL, and the
+ * largest deviation from the reference curve in *err.
+ */
+static const char *compare(const float *got, float *want, int n, int curve, float depth,
+                           const int len[3], float *err, int *at) {
+    reference_envelope(want, n, curve, depth, len[0], len[1], len[2]);
+
+    *err = 0.0f;
+    for (int i = 0; i < n; i++) {
+        float e = fabsf(got[i] - want[i]);
+        if (e > *err) {
+            *err = e;
+            *at = i;
+        }
+    }
+
+    /* Each ramp reaches its target exactly on its last sample, and not
+     * before unless the reference rounds onto it a sample early too */
+    int attack_end = len[0] - 1;
+    int release_end = len[0] + len[1] + len[2] - 1;
+    if (len[0] > 0 && (got[attack_end] != 1.0f - depth ||
+                       (attack_end > 0 && got[attack_end - 1] == 1.0f - depth &&
+                        want[attack_end - 1] != 1.0f - depth))) {
+        *at = attack_end;
+        return "attack end";
+    }
+    if (len[2] > 0 && (got[release_end] != 1.0f ||
+                       (len[2] > 1 && got[release_end - 1] == 1.0f &&
+                        want[release_end - 1] != 1.0f))) {
+        *at = release_end;
+        return "release end";
+    }
+    return (*err > ENVELOPE_TOLERANCE) ? "curve" : NULL;
+}
+
+/* Check one setting; returns the number of failures (0 or 1) */
+static int check_setting(float *got, float *want, int curve, float depth,
+                         float attack, float hold, float release, float *worst) {
+    int len[2][3];
+    for (int f = 0; f < 2; f++) {
+        len[f][0] = knob_samples(attack, 50.0f, f);
+        len[f][1] = knob_samples(hold, 500.0f, f);
+        len[f][2] = knob_samples(release, 1000.0f, f);
+    }
+
+    /* Whole blocks covering the envelope plus one block of settled unity */
+    int total = len[0][0] + len[0][1] + len[0][2] + 2 * TEST_FRAMES;
+    int n = (total + TEST_FRAMES - 1) / TEST_FRAMES * TEST_FRAMES;
+
+    render_plugin(got, n, g_curves[curve], depth, attack, hold, release);
+
+    /* Where the two evaluation orders disagree, judge the plugin against
+     * the lengths its curve actually follows */
+    float err = 0.0f;
+    int at = 0;
+    const char *what = compare(got, want, n, curve, depth, len[0], &err, &at);
+    if (memcmp(len[0], len[1], sizeof(len[0])) != 0) {
+        float err_folded;
+        int at_folded;
+        compare(got, want, n, curve, depth, len[1], &err_folded, &at_folded);
+        if (err_folded < err) {
+            what = compare(got, want, n, curve, depth, len[1], &err, &at);
+        } else {
+            compare(got, want, n, curve, depth, len[0], &err, &at);
+        }
+    }
+
+    if (!what) {
+        if (err > *worst) *worst = err;
+        return 0;
+    }
+    printf("FAIL %s: voices %s curve %s depth %.2f attack %.2f hold %.2f release %.2f, "
+           "sample %d got %.7f want %.7f\n",
+           what, g_voice_mode, g_curves[curve], depth, attack, hold, release, at, got[at], want[at]);
+    return 1;
+}
+
+int main(int argc, char **argv) {
+    const char *so_path = (argc > 1) ? argv[1] : "build/test/ducker.so";
+
+    void *handle = dlopen(so_path, RTLD_NOW | RTLD_LOCAL);
+    if (!handle) {
+        fprintf(stderr, "dlopen failed: %s\n", dlerror());
+        return 1;
+    }
+
+    audio_fx_init_v2_fn init = (audio_fx_init_v2_fn)dlsym(handle, AUDIO_FX_INIT_V2_SYMBOL);
+    g_on_midi = (on_midi_fn)dlsym(handle, "move_audio_fx_on_midi");
+    g_process_f32 = (process_f32_fn)dlsym(handle, "move_audio_fx_process_f32");
+    if (!init || !g_on_midi || !g_process_f32) {
+        fprintf(stderr, "missing exports in %s\n", so_path);
+        return 1;
+    }
+
+    host_api_v1_t host;
+    memset(&host, 0, sizeof(host));
+    host.api_version = MOVE_PLUGIN_API_VERSION;
+    host.sample_rate = MOVE_SAMPLE_RATE;
+    host.frames_per_block = TEST_FRAMES;
+    host.log = stub_log;
+
+    g_api = init(&host);
+    if (!g_api) {
+        fprintf(stderr, "init returned NULL\n");
+        return 1;
+    }
+
+    /* Longest run: 50ms attack + 100ms hold + 1000ms release + one block */
+    int max_frames = ms_to_samples(1150.0f) + 3 * TEST_FRAMES;
+    float *got = malloc((size_t)max_frames * sizeof(float));
+    float *want = malloc((size_t)max_frames * sizeof(float));
+
+    int runs = 0, failures = 0;
+    float worst = 0.0f;
+    for (int m = 0; m < 3; m++) {
+        g_voice_mode = g_voices[m];
+        for (int c = 0; c < 4; c++) {
+            for (int d = 0; d < 2; d++) {
+                for (int k = 0; k <= KNOB_STEPS; k++) {
+                    float v = (float)k / KNOB_STEPS;
+                    /* Sweep attack with a short release, then release with a short attack */
+                    failures += check_setting(got, want, c, g_depths[d], v, 0.2f, 0.05f, &worst);
+                    failures += check_setting(got, want, c, g_depths[d], 0.1f, 0.2f, v, &worst);
+                    runs += 2;
+                }
+            }
+        }
+    }
+
+    free(got);
+    free(want);
+    dlclose(handle);
+
+    printf("envelope: %d settings, %d failures, worst curve error %.2e\n", runs, failures, worst);
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,123 @@
+/*
+ * Trigger event queue overflow test
+ *
+ * Loads ducker.so in gate mode and sends more than MAX_EVENTS timestamped
+ * note events ahead of a single block through move_audio_fx_on_midi_at.
+ * However the queue overflows, events must still be applied in time
+ * order: equal numbers of note-ons and later note-offs leave the gate
+ * released, and one note-on more than note-offs leaves it held. The float32
+ * output with a DC input of 1.0 is the envelope gain, so released means
+ * back at exactly 1.0 and held means still below it.
+ *
+ * Usage: test_events [path/to/ducker.so]
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <dlfcn.h>
+#include "audio_fx_api_v2.h"
+
+#define TEST_FRAMES MOVE_FRAMES_PER_BLOCK
+
+/* Must be more than MAX_EVENTS in src/dsp/ducker.c (32) */
+#define NOTES 40
+
+typedef void (*on_midi_at_fn)(void *instance, const uint8_t *msg, int len, int source,
+                              int frame_offset);
+typedef void (*process_f32_fn)(void *instance, float *left, float *right, int frames);
+
+static audio_fx_api_v2_t *g_api;
+static on_midi_at_fn g_on_midi_at;
+static process_f32_fn g_process_f32;
+
+static void stub_log(const char *msg) {
+    (void)msg;
+}
+
+static void note(void *inst, int on, int frame) {
+    uint8_t msg[3] = { (uint8_t)(on ? 0x90 : 0x80), 36, (uint8_t)(on ? 127 : 0) };
+    g_on_midi_at(inst, msg, 3, MOVE_MIDI_SOURCE_INTERNAL, frame);
+}
+
+/* Render seconds of DC through the plugin; returns the final gain */
+static float render(void *inst, float seconds) {
+    int blocks = (int)(seconds * MOVE_SAMPLE_RATE / TEST_FRAMES);
+    float left[TEST_FRAMES], right[TEST_FRAMES];
+    for (int b = 0; b < blocks; b++) {
+        for (int i = 0; i < TEST_FRAMES; i++) left[i] = right[i] = 1.0f;
+        g_process_f32(inst, left, right, TEST_FRAMES);
+    }
+    return left[TEST_FRAMES - 1];
+}
+
+/* ons note-ons at one offset, then offs note-offs at a later one, all
+ * queued before the first block; returns the gain a second later */
+static float run(int ons, int on_frame, int offs, int off_frame) {
+    void *inst = g_api->create_instance(".", NULL);
+    g_api->set_param(inst, "mode", "Gate");
+    g_api->set_param(inst, "depth", "1");
+    g_api->set_param(inst, "attack", "0");
+    g_api->set_param(inst, "release", "0.05");
+
+    for (int i = 0; i < ons; i++) note(inst, 1, on_frame);
+    for (int i = 0; i < offs; i++) note(inst, 0, off_frame);
+    float gain = render(inst, 1.0f);
+
+    g_api->destroy_instance(inst);
+    return gain;
+}
+
+static int expect(const char *what, float gain, int held) {
+    int ok = held ? (gain < 1.0f) : (gain == 1.0f);
+    printf("%s %-44s gain %.6f (%s)\n", ok ? " " : "FAIL", what, gain,
+           held ? "want held" : "want released");
+    return ok ? 0 : 1;
+}
+
+int main(int argc, char **argv) {
+    const char *so_path = (argc > 1) ? argv[1] : "build/test/ducker.so";
+
+    void *handle = dlopen(so_path, RTLD_NOW | RTLD_LOCAL);
+    if (!handle) {
+        fprintf(stderr, "dlopen failed: %s\n", dlerror());
+        return 1;
+    }
+
+    audio_fx_init_v2_fn init = (audio_fx_init_v2_fn)dlsym(handle, AUDIO_FX_INIT_V2_SYMBOL);
+    g_on_midi_at = (on_midi_at_fn)dlsym(handle, "move_audio_fx_on_midi_at");
+    g_process_f32 = (process_f32_fn)dlsym(handle, "move_audio_fx_process_f32");
+    if (!init || !g_on_midi_at || !g_process_f32) {
+        fprintf(stderr, "missing exports in %s\n", so_path);
+        return 1;
+    }
+
+    host_api_v1_t host;
+    memset(&host, 0, sizeof(host));
+    host.api_version = MOVE_PLUGIN_API_VERSION;
+    host.sample_rate = MOVE_SAMPLE_RATE;
+    host.frames_per_block = TEST_FRAMES;
+    host.log = stub_log;
+
+    g_api = init(&host);
+    if (!g_api) {
+        fprintf(stderr, "init returned NULL\n");
+        return 1;
+    }
+
+    int failures = 0;
+
+    /* Note-offs arrive behind a queue already full of later note-ons */
+    failures += expect("40 ons @100, 40 offs @110", run(NOTES, 100, NOTES, 110), 0);
+    failures += expect("40 ons @100, 39 offs @110", run(NOTES, 100, NOTES - 1, 110), 1);
+
+    /* Offsets beyond the first block carry over while the queue is full */
+    failures += expect("40 ons @300, 40 offs @600", run(NOTES, 300, NOTES, 600), 0);
+    failures += expect("40 ons @300, 39 offs @600", run(NOTES, 300, NOTES - 1, 600), 1);
+
+    dlclose(handle);
+
+    printf("events: %d failures\n", failures);
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,160 @@
+/*
+ * Modulation route test
+ *
+ * Loads ducker.so with a host that counts modulation clears and emits.
+ * Setting mod_targets to the routes already live, directly or through a
+ * state load, must not clear and re-send them. A route set too long for
+ * the stored string must keep only whole routes, and the stored string
+ * must round-trip through a saved state into a fresh instance.
+ *
+ * Usage: test_mod_targets [path/to/ducker.so]
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <dlfcn.h>
+#include "audio_fx_api_v2.h"
+
+#define TEST_FRAMES MOVE_FRAMES_PER_BLOCK
+
+/* Must match src/dsp/ducker.c */
+#define STATE_JSON_MAX 4096
+
+static audio_fx_api_v2_t *g_api;
+static int g_clears, g_emits;
+
+static void stub_log(const char *msg) {
+    (void)msg;
+}
+
+static int stub_mod_emit_value(void *ctx, const char *source_id, const char *target,
+                               const char *param, float signal, float depth, float offset,
+                               int bipolar, int enabled) {
+    (void)ctx; (void)source_id; (void)target; (void)param; (void)signal;
+    (void)depth; (void)offset; (void)bipolar; (void)enabled;
+    g_emits++;
+    return 0;
+}
+
+static void stub_mod_clear_source(void *ctx, const char *source_id) {
+    (void)ctx;
+    (void)source_id;
+    g_clears++;
+}
+
+static void run_blocks(void *inst, int blocks) {
+    int16_t audio[TEST_FRAMES * 2];
+    memset(audio, 0, sizeof(audio));
+    for (int b = 0; b < blocks; b++) g_api->process_block(inst, audio, TEST_FRAMES);
+}
+
+static int expect_clears(const char *what, int want) {
+    if (g_clears == want) {
+        printf("  %-44s %d clears, %d emits\n", what, g_clears, g_emits);
+        return 0;
+    }
+    printf("FAIL %s: %d clears, want %d\n", what, g_clears, want);
+    return 1;
+}
+
+int main(int argc, char **argv) {
+    const char *so_path = (argc > 1) ? argv[1] : "build/test/ducker.so";
+
+    void *handle = dlopen(so_path, RTLD_NOW | RTLD_LOCAL);
+    if (!handle) {
+        fprintf(stderr, "dlopen failed: %s\n", dlerror());
+        return 1;
+    }
+
+    audio_fx_init_v2_fn init = (audio_fx_init_v2_fn)dlsym(handle, AUDIO_FX_INIT_V2_SYMBOL);
+    if (!init) {
+        fprintf(stderr, "missing %s in %s\n", AUDIO_FX_INIT_V2_SYMBOL, so_path);
+        return 1;
+    }
+
+    host_api_v1_t host;
+    memset(&host, 0, sizeof(host));
+    host.api_version = MOVE_PLUGIN_API_VERSION;
+    host.sample_rate = MOVE_SAMPLE_RATE;
+    host.frames_per_block = TEST_FRAMES;
+    host.log = stub_log;
+    host.mod_emit_value = stub_mod_emit_value;
+    host.mod_clear_source = stub_mod_clear_source;
+
+    g_api = init(&host);
+    if (!g_api) {
+        fprintf(stderr, "init returned NULL\n");
+        return 1;
+    }
+
+    int failures = 0;
+    static char state[STATE_JSON_MAX + 1];
+    char routes[512], stored[512];
+
+    void *inst = g_api->create_instance(".", NULL);
+    run_blocks(inst, 4);
+    g_clears = g_emits = 0;
+
+    /* New routes are published once */
+    g_api->set_param(inst, "mod_targets", "synth:cutoff:0.5,fx:mix:-0.25");
+    run_blocks(inst, 4);
+    failures += expect_clears("new routes", 1);
+
+    /* The same routes again, in canonical or original form */
+    g_api->set_param(inst, "mod_targets", "synth:cutoff:0.500,fx:mix:-0.250");
+    g_api->set_param(inst, "mod_targets", "synth:cutoff:0.5 fx:mix:-0.25");
+    run_blocks(inst, 4);
+    failures += expect_clears("same routes set again", 1);
+
+    /* A preset recall carrying the same routes */
+    g_api->get_param(inst, "state", state, (int)sizeof(state));
+    g_api->set_param(inst, "state", state);
+    run_blocks(inst, 4);
+    failures += expect_clears("state load with same routes", 1);
+
+    /* A real change still goes through */
+    g_api->set_param(inst, "mod_targets", "synth:cutoff:0.75");
+    run_blocks(inst, 4);
+    failures += expect_clears("changed routes", 2);
+
+    /* Four routes with 31-character names: only whole routes are kept */
+    const char *name = "bcdefghijklmnopqrstuvwxyz01234";
+    int len = 0;
+    for (int i = 0; i < 4; i++) {
+        len += snprintf(routes + len, sizeof(routes) - (size_t)len, "%s%c%s:%s0:0.500",
+                        i ? "," : "", 'a' + i, name, name);
+    }
+    g_api->set_param(inst, "mod_targets", routes);
+    g_api->get_param(inst, "mod_targets", stored, (int)sizeof(stored));
+    int kept = 0;
+    for (const char *p = stored; (p = strstr(p, ":0.500")) != NULL; p++) kept++;
+    int commas = 0;
+    for (const char *p = stored; *p; p++) commas += (*p == ',');
+    if (kept == 0 || kept == 4 || commas != kept - 1 ||
+        strcmp(stored + strlen(stored) - 6, ":0.500") != 0 ||
+        strncmp(routes, stored, strlen(stored)) != 0) {
+        printf("FAIL long routes: stored \"%s\"\n", stored);
+        failures++;
+    } else {
+        printf("  %-44s %d of 4 routes kept, %zu bytes\n", "long routes", kept, strlen(stored));
+    }
+
+    /* ...and they round-trip through a saved state */
+    g_api->get_param(inst, "state", state, (int)sizeof(state));
+    void *copy = g_api->create_instance(".", NULL);
+    g_api->set_param(copy, "state", state);
+    char restored[512];
+    g_api->get_param(copy, "mod_targets", restored, (int)sizeof(restored));
+    if (strcmp(stored, restored) != 0) {
+        printf("FAIL long routes round trip:\n  got  %s\n  want %s\n", restored, stored);
+        failures++;
+    }
+    g_api->destroy_instance(copy);
+    g_api->destroy_instance(inst);
+    dlclose(handle);
+
+    printf("mod targets: %d failures\n", failures);
+    return failures ? 1 : 0;
+}
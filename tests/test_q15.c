@@ -0,0 +1,351 @@
+/*
+ * Q15 gain test
+ *
+ * On NEON builds apply_gain() converts each gain to Q15 with
+ * vcvtq_n_s32_f32(g, 15) and vqmovn_s32, then scales samples with
+ * vqrdmulhq_s16; everywhere else it multiplies in float and truncates.
+ *
+ * The main check drives the real plugin. Two instances get identical
+ * settings and triggers: one renders a DC input of 1.0 through the float32
+ * export, so its output is the per-frame gain, and the other renders int16
+ * test audio through process_block. Every int16 output sample must be
+ * within Q15_TOLERANCE of the float reference for that frame's gain, and
+ * exactly equal to the input where the gain is unity. Held gates at depths
+ * across 0-1 cover every int16 sample value; attack/release ramps with
+ * smoothing and the voice pool cover per-frame gain changes.
+ *
+ * A supplementary check emulates the NEON chain in scalar code against the
+ * float reference over a dense gain grid, so the Q15 arithmetic itself is
+ * covered on any host. Built with NEON, the emulation is also checked bit
+ * for bit against the intrinsics.
+ *
+ * Usage: test_q15 [path/to/ducker.so]
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <math.h>
+#include <dlfcn.h>
+#include "audio_fx_api_v2.h"
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define TEST_NEON 1
+#endif
+
+/*
+ * One LSB. The Q15 gain is truncated (up to 2^-15 low, under one LSB of
+ * output at full scale) and the product rounded, while the float path
+ * truncates the product; together they never differ by more than one.
+ */
+#define Q15_TOLERANCE 1
+
+#define TEST_FRAMES MOVE_FRAMES_PER_BLOCK
+
+/* Gains step through Q15 codes this far apart on the emulation pass */
+#define GAIN_CODE_STEP 16
+#define RANDOM_PAIRS 4000000
+
+typedef void (*on_midi_fn)(void *instance, const uint8_t *msg, int len, int source);
+typedef void (*process_f32_fn)(void *instance, float *left, float *right, int frames);
+
+static audio_fx_api_v2_t *g_api;
+static on_midi_fn g_on_midi;
+static process_f32_fn g_process_f32;
+static uint32_t g_seed = 0x51EEDu;
+
+static void stub_log(const char *msg) {
+    (void)msg;
+}
+
+static uint32_t rnd(void) {
+    g_seed = g_seed * 1664525u + 1013904223u;
+    return g_seed >> 8;
+}
+
+/* --- Float reference (apply_gain's scalar loop) --- */
+
+static int16_t ref_gain(int16_t x, float gain) {
+    float y = (float)x * gain;
+    if (y > 32767.0f) y = 32767.0f;
+    if (y < -32768.0f) y = -32768.0f;
+    return (int16_t)y;
+}
+
+/* --- Scalar emulation of the NEON chain --- */
+
+/* vcvtq_n_s32_f32(x, 15): scale by 2^15, round toward zero, saturate; NaN is 0 */
+static int32_t emu_cvt_n15(float x) {
+    double v = (double)x * 32768.0;
+    if (v != v) return 0;
+    if (v >= 2147483647.0) return INT32_MAX;
+    if (v <= -2147483648.0) return INT32_MIN;
+    return (int32_t)v;
+}
+
+/* vqmovn_s32: saturating narrow to int16 */
+static int16_t emu_qmovn(int32_t x) {
+    if (x > INT16_MAX) return INT16_MAX;
+    if (x < INT16_MIN) return INT16_MIN;
+    return (int16_t)x;
+}
+
+/* vqrdmulhq_s16: (2ab + 2^15) >> 16, saturating (only -32768 * -32768) */
+static int16_t emu_qrdmulh(int16_t a, int16_t b) {
+    int64_t p = 2 * (int64_t)a * (int64_t)b + (1 << 15);
+    p >>= 16;
+    if (p > INT16_MAX) return INT16_MAX;
+    return (int16_t)p;
+}
+
+static int16_t emu_gain(int16_t x, float gain) {
+    return emu_qrdmulh(x, emu_qmovn(emu_cvt_n15(gain)));
+}
+
+/* --- Emulation checks --- */
+
+static long g_checked, g_failures;
+static long g_diff_count[2 * Q15_TOLERANCE + 1];
+
+static void check(int16_t x, float gain) {
+    int diff = (int)emu_gain(x, gain) - (int)ref_gain(x, gain);
+    g_checked++;
+    if (diff < -Q15_TOLERANCE || diff > Q15_TOLERANCE) {
+        if (g_failures++ < 10) {
+            printf("FAIL x=%d gain=%.9g: q15 %d, float %d\n",
+                   x, gain, emu_gain(x, gain), ref_gain(x, gain));
+        }
+        return;
+    }
+    g_diff_count[diff + Q15_TOLERANCE]++;
+}
+
+static void check_all_samples(float gain) {
+    for (int x = INT16_MIN; x <= INT16_MAX; x++) check((int16_t)x, gain);
+}
+
+#ifdef TEST_NEON
+/* The emulation must match the intrinsics exactly, 8 lanes at a time */
+static long check_intrinsics(float gain) {
+    long mismatches = 0;
+    float g8[8];
+    for (int k = 0; k < 8; k++) g8[k] = gain;
+    int32x4_t lo = vcvtq_n_s32_f32(vld1q_f32(g8), 15);
+    int32x4_t hi = vcvtq_n_s32_f32(vld1q_f32(g8 + 4), 15);
+    int16x8_t g = vcombine_s16(vqmovn_s32(lo), vqmovn_s32(hi));
+
+    for (int x = INT16_MIN; x <= INT16_MAX; x += 8) {
+        int16_t in[8], out[8];
+        for (int k = 0; k < 8; k++) in[k] = (int16_t)(x + k);
+        vst1q_s16(out, vqrdmulhq_s16(vld1q_s16(in), g));
+        for (int k = 0; k < 8; k++) {
+            if (out[k] != emu_gain(in[k], gain)) {
+                if (mismatches++ < 10) {
+                    printf("FAIL intrinsics x=%d gain=%.9g: neon %d, emulated %d\n",
+                           in[k], gain, out[k], emu_gain(in[k], gain));
+                }
+            }
+        }
+    }
+    return mismatches;
+}
+#endif
+
+/* --- Plugin checks --- */
+
+/* An int16 instance and a float32 twin with the same settings and triggers */
+typedef struct pair {
+    void *audio;
+    void *gain;
+} pair_t;
+
+static long g_plugin_checked, g_plugin_unity, g_plugin_failures;
+static long g_plugin_diff_count[2 * Q15_TOLERANCE + 1];
+
+static void pair_create(pair_t *p) {
+    p->audio = g_api->create_instance(".", NULL);
+    p->gain = g_api->create_instance(".", NULL);
+}
+
+static void pair_destroy(pair_t *p) {
+    g_api->destroy_instance(p->audio);
+    g_api->destroy_instance(p->gain);
+}
+
+static void pair_set(pair_t *p, const char *key, const char *val) {
+    g_api->set_param(p->audio, key, val);
+    g_api->set_param(p->gain, key, val);
+}
+
+static void pair_note_on(pair_t *p) {
+    uint8_t on[3] = { 0x90, 36, 127 };
+    g_on_midi(p->audio, on, 3, MOVE_MIDI_SOURCE_INTERNAL);
+    g_on_midi(p->gain, on, 3, MOVE_MIDI_SOURCE_INTERNAL);
+}
+
+/* Render one block of audio (stereo interleaved) and check it against the
+ * float reference at the twin's per-frame gain */
+static void pair_block(pair_t *p, int16_t *audio, const char *what) {
+    int16_t in[TEST_FRAMES * 2];
+    float gain[TEST_FRAMES], right[TEST_FRAMES];
+
+    memcpy(in, audio, sizeof(in));
+    for (int i = 0; i < TEST_FRAMES; i++) gain[i] = right[i] = 1.0f;
+    g_process_f32(p->gain, gain, right, TEST_FRAMES);
+    g_api->process_block(p->audio, audio, TEST_FRAMES);
+
+    for (int i = 0; i < TEST_FRAMES * 2; i++) {
+        float g = gain[i / 2];
+        int want = ref_gain(in[i], g);
+        int diff = (int)audio[i] - want;
+        int tolerance = (g == 1.0f) ? 0 : Q15_TOLERANCE;
+        g_plugin_checked++;
+        if (g == 1.0f) g_plugin_unity++;
+        if (diff < -tolerance || diff > tolerance) {
+            if (g_plugin_failures++ < 10) {
+                printf("FAIL %s: frame %d %s in %d gain %.9g: got %d, float %d\n",
+                       what, i / 2, (i & 1) ? "R" : "L", in[i], g, audio[i], want);
+            }
+            continue;
+        }
+        g_plugin_diff_count[diff + Q15_TOLERANCE]++;
+    }
+}
+
+/* Gate held at one depth while every int16 value passes through, on L
+ * ascending and R descending so a channel or lane mix-up shows */
+static void check_held(float depth) {
+    char what[48], buf[32];
+    snprintf(what, sizeof(what), "held depth %.4f", depth);
+    snprintf(buf, sizeof(buf), "%.4f", depth);
+
+    pair_t p;
+    pair_create(&p);
+    pair_set(&p, "mode", "Gate");
+    pair_set(&p, "attack", "0");
+    pair_set(&p, "depth", buf);
+    /* Smoothing keeps depth 0 on the apply_gain path at exactly unity */
+    pair_set(&p, "smoothing", "0.2");
+    pair_note_on(&p);
+
+    int16_t audio[TEST_FRAMES * 2];
+    for (int k = 0; k < 65536; k += TEST_FRAMES) {
+        for (int i = 0; i < TEST_FRAMES; i++) {
+            audio[i * 2] = (int16_t)(k + i - 32768);
+            audio[i * 2 + 1] = (int16_t)(32767 - k - i);
+        }
+        pair_block(&p, audio, what);
+    }
+    pair_destroy(&p);
+}
+
+/* Repeated triggers through ramps, smoothing tails and idle, random audio */
+static void check_ramps(const char *curve, const char *voices) {
+    char what[48];
+    snprintf(what, sizeof(what), "ramps %s %s", curve, voices);
+
+    pair_t p;
+    pair_create(&p);
+    pair_set(&p, "curve", curve);
+    pair_set(&p, "voices", voices);
+    pair_set(&p, "depth", "0.8");
+    pair_set(&p, "attack", "0.3");
+    pair_set(&p, "hold", "0.05");
+    pair_set(&p, "release", "0.2");
+    pair_set(&p, "smoothing", "0.5");
+
+    int16_t audio[TEST_FRAMES * 2];
+    for (int b = 0; b < 1200; b++) {
+        /* Triggers overlap in the first half, then let it go idle */
+        if (b % 150 == 0 && b < 600) pair_note_on(&p);
+        for (int i = 0; i < TEST_FRAMES * 2; i++) audio[i] = (int16_t)(rnd() & 0xFFFF);
+        pair_block(&p, audio, what);
+    }
+    pair_destroy(&p);
+}
+
+int main(int argc, char **argv) {
+    const char *so_path = (argc > 1) ? argv[1] : "build/test/ducker.so";
+
+    void *handle = dlopen(so_path, RTLD_NOW | RTLD_LOCAL);
+    if (!handle) {
+        fprintf(stderr, "dlopen failed: %s\n", dlerror());
+        return 1;
+    }
+
+    audio_fx_init_v2_fn init = (audio_fx_init_v2_fn)dlsym(handle, AUDIO_FX_INIT_V2_SYMBOL);
+    g_on_midi = (on_midi_fn)dlsym(handle, "move_audio_fx_on_midi");
+    g_process_f32 = (process_f32_fn)dlsym(handle, "move_audio_fx_process_f32");
+    if (!init || !g_on_midi || !g_process_f32) {
+        fprintf(stderr, "missing exports in %s\n", so_path);
+        return 1;
+    }
+
+    host_api_v1_t host;
+    memset(&host, 0, sizeof(host));
+    host.api_version = MOVE_PLUGIN_API_VERSION;
+    host.sample_rate = MOVE_SAMPLE_RATE;
+    host.frames_per_block = TEST_FRAMES;
+    host.log = stub_log;
+
+    g_api = init(&host);
+    if (!g_api) {
+        fprintf(stderr, "init returned NULL\n");
+        return 1;
+    }
+
+    static const float odd_depths[] = { 0.0001f, 0.3333f, 0.5001f, 0.9999f };
+    for (int k = 0; k <= 64; k++) check_held((float)k / 64.0f);
+    for (int k = 0; k < 4; k++) check_held(odd_depths[k]);
+
+    static const char *curves[] = { "Linear", "Expo", "S-Curve", "Pump" };
+    static const char *voices[] = { "Mono", "Min", "Product" };
+    for (int c = 0; c < 4; c++) {
+        for (int v = 0; v < 3; v++) check_ramps(curves[c], voices[v]);
+    }
+
+    dlclose(handle);
+
+    printf("q15 plugin: %ld samples (%ld at unity), %ld failures\n",
+           g_plugin_checked, g_plugin_unity, g_plugin_failures);
+    printf("  output - float: -1: %ld, 0: %ld, +1: %ld\n",
+           g_plugin_diff_count[0], g_plugin_diff_count[1], g_plugin_diff_count[2]);
+
+    long neon_mismatches = 0;
+    int gains = 0;
+
+    /* Each sampled Q15 code and the float just below it, 0 through 1.0 */
+    for (int code = 0; code <= 32768; code += GAIN_CODE_STEP) {
+        float gain = (float)code / 32768.0f;
+        check_all_samples(gain);
+        gains++;
+        if (code > 0) {
+            check_all_samples(nextafterf(gain, 0.0f));
+            gains++;
+        }
+#ifdef TEST_NEON
+        neon_mismatches += check_intrinsics(gain);
+        if (code > 0) neon_mismatches += check_intrinsics(nextafterf(gain, 0.0f));
+#endif
+    }
+
+    /* Random samples at random gains in 0-1 */
+    for (long n = 0; n < RANDOM_PAIRS; n++) {
+        float gain = (float)(rnd() & 0xFFFFFF) / (float)0xFFFFFF;
+        check((int16_t)(rnd() & 0xFFFF), gain);
+    }
+
+    printf("q15 emulation: %ld checks over %d gains + %d random, %ld failures\n",
+           g_checked, gains, RANDOM_PAIRS, g_failures);
+    printf("  q15 - float: -1: %ld, 0: %ld, +1: %ld\n",
+           g_diff_count[0], g_diff_count[1], g_diff_count[2]);
+#ifdef TEST_NEON
+    printf("  intrinsics: %ld mismatches\n", neon_mismatches);
+#else
+    printf("  intrinsics: not checked (no NEON)\n");
+#endif
+
+    return (g_plugin_failures || g_failures || neon_mismatches) ? 1 : 0;
+}
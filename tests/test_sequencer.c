@@ -0,0 +1,182 @@
+/*
+ * Step sequencer transport test
+ *
+ * Loads ducker.so with a host whose clock status and tempo the test sets,
+ * feeds MIDI clock ticks at 120 BPM, and counts sequencer triggers in the
+ * float32 output (DC input of 1.0, so a dip below unity is a trigger). The
+ * sequencer must follow a transport that is already running when the
+ * instance is created or the sequencer is switched on, and must carry on
+ * after a brief status dropout, all without a fresh Start. It must stay
+ * silent while the host reports the transport stopped.
+ *
+ * Usage: test_sequencer [path/to/ducker.so]
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <dlfcn.h>
+#include "audio_fx_api_v2.h"
+
+#define TEST_FRAMES MOVE_FRAMES_PER_BLOCK
+#define TEST_BPM 120.0f
+
+/* 44100 * 60 / (120 * 24): one 24 ppqn tick at TEST_BPM */
+#define FRAMES_PER_TICK 918.75
+
+typedef void (*on_midi_fn)(void *instance, const uint8_t *msg, int len, int source);
+typedef void (*process_f32_fn)(void *instance, float *left, float *right, int frames);
+
+static audio_fx_api_v2_t *g_api;
+static on_midi_fn g_on_midi;
+static process_f32_fn g_process_f32;
+static int g_clock_status = MOVE_CLOCK_STATUS_RUNNING;
+
+static void stub_log(const char *msg) {
+    (void)msg;
+}
+
+static float stub_get_bpm(void) {
+    return TEST_BPM;
+}
+
+static int stub_get_clock_status(void) {
+    return g_clock_status;
+}
+
+/* One transport run: ticks are sent at their due time before each block */
+typedef struct run {
+    void *inst;
+    double next_tick;     /* frame of the next clock tick */
+    long frame;           /* frames rendered so far */
+    int ducked;           /* last rendered frame was below unity */
+} run_t;
+
+static void send_realtime(run_t *r, uint8_t status) {
+    g_on_midi(r->inst, &status, 1, MOVE_MIDI_SOURCE_HOST);
+}
+
+/* Render seconds of audio with the clock ticking; returns the number of
+ * trigger onsets seen */
+static int render(run_t *r, float seconds) {
+    int blocks = (int)(seconds * MOVE_SAMPLE_RATE / TEST_FRAMES);
+    int onsets = 0;
+    float left[TEST_FRAMES], right[TEST_FRAMES];
+
+    for (int b = 0; b < blocks; b++) {
+        while (r->next_tick < (double)(r->frame + TEST_FRAMES)) {
+            send_realtime(r, 0xF8);
+            r->next_tick += FRAMES_PER_TICK;
+        }
+        for (int i = 0; i < TEST_FRAMES; i++) left[i] = right[i] = 1.0f;
+        g_process_f32(r->inst, left, right, TEST_FRAMES);
+        for (int i = 0; i < TEST_FRAMES; i++) {
+            int ducked = left[i] < 0.999f;
+            if (ducked && !r->ducked) onsets++;
+            r->ducked = ducked;
+        }
+        r->frame += TEST_FRAMES;
+    }
+    return onsets;
+}
+
+/* Quarter-note triggers with a short envelope, so each one is distinct */
+static void start_run(run_t *r, const char *seq) {
+    memset(r, 0, sizeof(*r));
+    r->inst = g_api->create_instance(".", NULL);
+    g_api->set_param(r->inst, "seq", seq);
+    g_api->set_param(r->inst, "seq_pattern", "Quarters");
+    g_api->set_param(r->inst, "depth", "1");
+    g_api->set_param(r->inst, "attack", "0");
+    g_api->set_param(r->inst, "hold", "0");
+    g_api->set_param(r->inst, "release", "0.05");
+}
+
+static int expect(const char *what, int got, int lo, int hi) {
+    if (got >= lo && got <= hi) {
+        printf("  %-40s %d triggers\n", what, got);
+        return 0;
+    }
+    printf("FAIL %s: %d triggers, want %d-%d\n", what, got, lo, hi);
+    return 1;
+}
+
+int main(int argc, char **argv) {
+    const char *so_path = (argc > 1) ? argv[1] : "build/test/ducker.so";
+
+    void *handle = dlopen(so_path, RTLD_NOW | RTLD_LOCAL);
+    if (!handle) {
+        fprintf(stderr, "dlopen failed: %s\n", dlerror());
+        return 1;
+    }
+
+    audio_fx_init_v2_fn init = (audio_fx_init_v2_fn)dlsym(handle, AUDIO_FX_INIT_V2_SYMBOL);
+    g_on_midi = (on_midi_fn)dlsym(handle, "move_audio_fx_on_midi");
+    g_process_f32 = (process_f32_fn)dlsym(handle, "move_audio_fx_process_f32");
+    if (!init || !g_on_midi || !g_process_f32) {
+        fprintf(stderr, "missing exports in %s\n", so_path);
+        return 1;
+    }
+
+    host_api_v1_t host;
+    memset(&host, 0, sizeof(host));
+    host.api_version = MOVE_PLUGIN_API_VERSION;
+    host.sample_rate = MOVE_SAMPLE_RATE;
+    host.frames_per_block = TEST_FRAMES;
+    host.log = stub_log;
+    host.get_bpm = stub_get_bpm;
+    host.get_clock_status = stub_get_clock_status;
+
+    g_api = init(&host);
+    if (!g_api) {
+        fprintf(stderr, "init returned NULL\n");
+        return 1;
+    }
+
+    int failures = 0;
+    run_t r;
+
+    /* Quarters at 120 BPM: one trigger every 0.5s */
+
+    /* Started normally */
+    g_clock_status = MOVE_CLOCK_STATUS_RUNNING;
+    start_run(&r, "On");
+    send_realtime(&r, 0xFA);
+    failures += expect("start, 1.8s", render(&r, 1.8f), 4, 4);
+    g_api->destroy_instance(r.inst);
+
+    /* Created while the transport is already playing: no Start */
+    start_run(&r, "On");
+    failures += expect("created mid-song, 1.8s", render(&r, 1.8f), 3, 4);
+    g_api->destroy_instance(r.inst);
+
+    /* Sequencer switched on mid-song */
+    start_run(&r, "Off");
+    send_realtime(&r, 0xFA);
+    failures += expect("sequencer off, 1s", render(&r, 1.0f), 0, 0);
+    g_api->set_param(r.inst, "seq", "On");
+    failures += expect("sequencer switched on, 1.8s", render(&r, 1.8f), 3, 4);
+
+    /* A brief status dropout pauses it; it resumes without a Start */
+    g_clock_status = MOVE_CLOCK_STATUS_UNAVAILABLE;
+    failures += expect("status dropout, 0.2s", render(&r, 0.2f), 0, 0);
+    g_clock_status = MOVE_CLOCK_STATUS_RUNNING;
+    failures += expect("after dropout, 1.8s", render(&r, 1.8f), 3, 4);
+
+    /* Stop, then clock with the transport reported stopped */
+    send_realtime(&r, 0xFC);
+    g_clock_status = MOVE_CLOCK_STATUS_STOPPED;
+    failures += expect("stopped with clock, 2s", render(&r, 2.0f), 0, 0);
+    g_api->destroy_instance(r.inst);
+
+    /* Created while stopped, clock ticking: stays silent */
+    start_run(&r, "On");
+    failures += expect("created while stopped, 2s", render(&r, 2.0f), 0, 0);
+    g_api->destroy_instance(r.inst);
+
+    dlclose(handle);
+
+    printf("sequencer: %d failures\n", failures);
+    return failures ? 1 : 0;
+}
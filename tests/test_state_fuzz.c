@@ -0,0 +1,306 @@
+/*
+ * State parser fuzz and timing test
+ *
+ * Loads ducker.so and feeds set_param("state") random bytes, mutations of a
+ * real saved state and hand-built worst cases (deep nesting, escape runs,
+ * thousands of keys), all up to STATE_JSON_MAX bytes. Every call must
+ * return within STATE_PARSE_BOUND_US; inputs over STATE_JSON_MAX must be
+ * ignored outright, and no nan or inf may survive into the saved state.
+ * Memory errors are left to the sanitizers: build ducker.so and this test
+ * with -fsanitize=address,undefined and raise the bound with -b.
+ *
+ * Usage: test_state_fuzz [path/to/ducker.so] [-n inputs] [-b bound_us]
+ */
+
+#define _POSIX_C_SOURCE 199309L
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <time.h>
+#include <dlfcn.h>
+#include "audio_fx_api_v2.h"
+
+/* Must match src/dsp/ducker.c */
+#define STATE_JSON_MAX 4096
+
+/*
+ * Worst case for one set_param("state") call. The slowest full-length
+ * inputs take around 200us on a desktop x86 core; the bound leaves room for
+ * a slower machine while still catching anything superlinear.
+ */
+#define STATE_PARSE_BOUND_US 2000.0
+
+/* Calls slower than an eighth of the bound are re-timed this many times
+ * and the fastest run kept, so a preempted call is not taken for a slow
+ * parse */
+#define RETIME_RUNS 5
+
+static double g_bound_us = STATE_PARSE_BOUND_US;
+static audio_fx_api_v2_t *g_api;
+static void *g_inst;
+static uint32_t g_seed = 0xC0FFEEu;
+
+static const char *g_tokens[] = {
+    "{", "}", "[", "]", "\"", ":", ",", "\\", "\\\"", "\\u00", " ", "\n",
+    "0", "-1", "1e39", "-1e-50", "999999999999", "0.5", "nan", "inf", "-inf",
+    "true", "null", "\"depth\":", "\"curve\":\"Pump\"", "\"channel\":",
+    "\"trigger_map\":\"", "\"mod_targets\":\"", "36:0.5,", "a:b:0.5,",
+};
+
+static void stub_log(const char *msg) {
+    (void)msg;
+}
+
+static uint32_t rnd(void) {
+    g_seed = g_seed * 1664525u + 1013904223u;
+    return g_seed >> 8;
+}
+
+static inline double now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e6 + (double)ts.tv_nsec * 1e-3;
+}
+
+/* Time one state load; slow calls are re-timed to filter out preemption */
+static double time_state(const char *json) {
+    double best = 0.0;
+    for (int run = 0; run < RETIME_RUNS; run++) {
+        double t0 = now_us();
+        g_api->set_param(g_inst, "state", json);
+        double dt = now_us() - t0;
+        if (run == 0 || dt < best) best = dt;
+        if (best <= g_bound_us / 8.0) break;
+    }
+    return best;
+}
+
+/* Append s at len, never past cap - 1; returns the new length */
+static int append(char *buf, int len, int cap, const char *s) {
+    while (*s && len < cap - 1) buf[len++] = *s++;
+    buf[len] = '\0';
+    return len;
+}
+
+static int gen_random(char *buf, int cap) {
+    int len = (int)(rnd() % (uint32_t)cap);
+    for (int i = 0; i < len; i++) buf[i] = (char)(1 + rnd() % 255);
+    buf[len] = '\0';
+    return len;
+}
+
+static int gen_mutated(char *buf, int cap, const char *seed_state) {
+    int len = append(buf, 0, cap, seed_state);
+    int edits = 1 + (int)(rnd() % 16);
+
+    for (int e = 0; e < edits && len > 0; e++) {
+        int at = (int)(rnd() % (uint32_t)len);
+        switch (rnd() % 5) {
+        case 0:     /* flip a byte */
+            buf[at] = (char)(1 + rnd() % 255);
+            break;
+        case 1:     /* delete a run */
+            {
+                int n = 1 + (int)(rnd() % 32);
+                if (at + n > len) n = len - at;
+                memmove(buf + at, buf + at + n, (size_t)(len - at - n) + 1);
+                len -= n;
+            }
+            break;
+        case 2:     /* insert a token */
+            {
+                const char *tok = g_tokens[rnd() % (sizeof(g_tokens) / sizeof(g_tokens[0]))];
+                int n = (int)strlen(tok);
+                if (len + n >= cap) break;
+                memmove(buf + at + n, buf + at, (size_t)(len - at) + 1);
+                memcpy(buf + at, tok, (size_t)n);
+                len += n;
+            }
+            break;
+        case 3:     /* truncate */
+            buf[at] = '\0';
+            len = at;
+            break;
+        default:    /* repeat a chunk to push toward full length */
+            {
+                int n = 1 + (int)(rnd() % 256);
+                if (at + n > len) n = len - at;
+                while (len + n < cap - 1 && rnd() % 8) {
+                    memmove(buf + at + n, buf + at, (size_t)(len - at) + 1);
+                    len += n;
+                }
+            }
+            break;
+        }
+    }
+    return len;
+}
+
+/* Hand-built inputs that stress each part of the parser at full length */
+static int gen_adversarial(char *buf, int cap, int kind) {
+    int len = 0;
+    switch (kind) {
+    case 0:     /* nesting as deep as the input allows */
+        len = append(buf, len, cap, "{\"x\":");
+        while (len < cap - 1) len = append(buf, len, cap, "[");
+        break;
+    case 1:     /* one string made of escapes */
+        len = append(buf, len, cap, "{\"trigger_map\":\"");
+        while (len < cap - 1) len = append(buf, len, cap, "\\\\\\\"");
+        break;
+    case 2:     /* thousands of short known keys */
+        len = append(buf, len, cap, "{");
+        while (len < cap - 1) len = append(buf, len, cap, "\"depth\":0.5,");
+        break;
+    case 3:     /* thousands of unknown keys */
+        len = append(buf, len, cap, "{");
+        while (len < cap - 1) len = append(buf, len, cap, "\"zz\":1,");
+        break;
+    case 4:     /* a single huge number token */
+        len = append(buf, len, cap, "{\"depth\":");
+        while (len < cap - 1) len = append(buf, len, cap, "9");
+        break;
+    default:    /* a trigger map that fills the input */
+        len = append(buf, len, cap, "{\"trigger_map\":\"");
+        while (len < cap - 1) len = append(buf, len, cap, "36:0.5,");
+        break;
+    }
+    return len;
+}
+
+int main(int argc, char **argv) {
+    const char *so_path = "build/test/ducker.so";
+    int inputs = 100000;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+            inputs = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-b") == 0 && i + 1 < argc) {
+            g_bound_us = atof(argv[++i]);
+        } else {
+            so_path = argv[i];
+        }
+    }
+
+    void *handle = dlopen(so_path, RTLD_NOW | RTLD_LOCAL);
+    if (!handle) {
+        fprintf(stderr, "dlopen failed: %s\n", dlerror());
+        return 1;
+    }
+
+    audio_fx_init_v2_fn init = (audio_fx_init_v2_fn)dlsym(handle, AUDIO_FX_INIT_V2_SYMBOL);
+    if (!init) {
+        fprintf(stderr, "missing %s in %s\n", AUDIO_FX_INIT_V2_SYMBOL, so_path);
+        return 1;
+    }
+
+    host_api_v1_t host;
+    memset(&host, 0, sizeof(host));
+    host.api_version = MOVE_PLUGIN_API_VERSION;
+    host.sample_rate = MOVE_SAMPLE_RATE;
+    host.frames_per_block = MOVE_FRAMES_PER_BLOCK;
+    host.log = stub_log;
+
+    g_api = init(&host);
+    if (!g_api) {
+        fprintf(stderr, "init returned NULL\n");
+        return 1;
+    }
+    g_inst = g_api->create_instance(".", NULL);
+
+    /* A real saved state with both string parameters in use */
+    g_api->set_param(g_inst, "trigger_map", "38:0.5,40:0.25");
+    g_api->set_param(g_inst, "mod_targets", "synth:cutoff:0.5");
+    static char seed_state[STATE_JSON_MAX + 1];
+    if (g_api->get_param(g_inst, "state", seed_state, sizeof(seed_state)) <= 0) {
+        fprintf(stderr, "get_param(state) failed\n");
+        return 1;
+    }
+
+    static char buf[2 * STATE_JSON_MAX + 2];
+    static int16_t audio[MOVE_FRAMES_PER_BLOCK * 2];
+    double worst = 0.0;
+    int worst_len = 0, failures = 0;
+
+    for (int n = 0; n < inputs; n++) {
+        int len;
+        switch (n % 3) {
+        case 0:  len = gen_random(buf, STATE_JSON_MAX + 1); break;
+        case 1:  len = gen_mutated(buf, STATE_JSON_MAX + 1, seed_state); break;
+        default: len = gen_adversarial(buf, STATE_JSON_MAX + 1, n / 3 % 6); break;
+        }
+
+        double dt = time_state(buf);
+        if (dt > worst) {
+            worst = dt;
+            worst_len = len;
+        }
+        if (dt > g_bound_us) {
+            printf("FAIL time: %d-byte input took %.1f us\n", len, dt);
+            failures++;
+        }
+
+        /* Keep the audio side draining so the command ring cycles */
+        if (n % 64 == 0) g_api->process_block(g_inst, audio, MOVE_FRAMES_PER_BLOCK);
+    }
+
+    /* Over-length input is ignored even when it starts out valid */
+    g_api->set_param(g_inst, "depth", "0.25");
+    int len = append(buf, 0, (int)sizeof(buf), "{\"depth\":0.75,\"zz\":\"");
+    while (len < STATE_JSON_MAX + 1) len = append(buf, len, (int)sizeof(buf), "x");
+    len = append(buf, len, (int)sizeof(buf), "\"}");
+    double dt = time_state(buf);
+    char value[32];
+    g_api->get_param(g_inst, "depth", value, sizeof(value));
+    if (strcmp(value, "0.25") != 0 || dt > g_bound_us) {
+        printf("FAIL over-length: %d-byte input gave depth %s in %.1f us\n", len, value, dt);
+        failures++;
+    }
+
+    /* A string value cut off by the end of the input is not applied */
+    static const char *const truncated[][2] = {
+        { "trigger_map", "{\"trigger_map\":\"40:0.5" },
+        { "mod_targets", "{\"mod_targets\":\"a:b:0.5" },
+        { "curve", "{\"curve\":\"Pump" },
+    };
+    g_api->set_param(g_inst, "curve", "Linear");
+    for (int i = 0; i < 3; i++) {
+        char before[STATE_JSON_MAX + 1], after[STATE_JSON_MAX + 1];
+        g_api->get_param(g_inst, truncated[i][0], before, (int)sizeof(before));
+        time_state(truncated[i][1]);
+        g_api->get_param(g_inst, truncated[i][0], after, (int)sizeof(after));
+        if (strcmp(before, after) != 0) {
+            printf("FAIL truncated string: %s changed from \"%s\" to \"%s\"\n",
+                   truncated[i][0], before, after);
+            failures++;
+        }
+    }
+
+    /* Whatever got through was clamped to something finite; the string
+     * parameters come last and may hold route names like "inf" */
+    g_api->get_param(g_inst, "state", buf, (int)sizeof(buf));
+    char *strings = strstr(buf, "\"trigger_map\"");
+    if (strings) *strings = '\0';
+    if (strstr(buf, "nan") || strstr(buf, "inf")) {
+        printf("FAIL non-finite value in state: %s\n", buf);
+        failures++;
+    }
+
+    /* The instance still round-trips a clean state afterwards */
+    g_api->set_param(g_inst, "state", seed_state);
+    g_api->process_block(g_inst, audio, MOVE_FRAMES_PER_BLOCK);
+    g_api->get_param(g_inst, "state", buf, (int)sizeof(buf));
+    if (strcmp(buf, seed_state) != 0) {
+        printf("FAIL round trip:\n  got  %s\n  want %s\n", buf, seed_state);
+        failures++;
+    }
+
+    g_api->destroy_instance(g_inst);
+    dlclose(handle);
+
+    printf("state fuzz: %d inputs, %d failures, worst %.1f us (%d bytes), bound %.0f us\n",
+           inputs, failures, worst, worst_len, g_bound_us);
+    return failures ? 1 : 0;
+}